@@ -37,6 +37,15 @@ public:
         return ptree_.get<T>( key );
     }
 
+    bool GetChild( const char *key, boost::property_tree::ptree &child ) const
+    {
+        auto optional = ptree_.get_child_optional( key );
+        if ( !optional )
+            return false;
+        child = *optional;
+        return true;
+    }
+
     template<typename T>
     void Insert( const char *key, T val )
     {
@@ -0,0 +1,7 @@
+#ifndef __CONFIGURE_H
+
+#define HAVE_SYS_PRCTL_H
+#define HAVE_EXEC_INFO_H
+/* #undef HAVE_LEVELDB_H */
+
+#endif
@@ -0,0 +1,215 @@
+/*
+===========================================================================
+
+This software is licensed under the Apache 2 license, quoted below.
+
+Copyright (C) 2013 Andrey Budnik <budnik27@gmail.com>
+
+Licensed under the Apache License, Version 2.0 (the "License"); you may not
+use this file except in compliance with the License. You may obtain a copy of
+the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+License for the specific language governing permissions and limitations under
+the License.
+
+===========================================================================
+*/
+
+
+#ifndef __INTERVAL_SET_H
+#define __INTERVAL_SET_H
+
+#include <map>
+#include <iterator>
+#include <cstddef>
+
+namespace common {
+
+// Set of integers stored as disjoint closed intervals [first, last].
+// Dense sets, like task ids of a job, take memory proportional to the number
+// of gaps instead of the number of elements.
+class IntervalSet
+{
+public:
+    typedef std::map< int, int > Intervals; // first -> last
+
+    class const_iterator
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef int value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const int *pointer;
+        typedef const int &reference;
+
+    public:
+        const_iterator( Intervals::const_iterator it, Intervals::const_iterator end )
+        : it_( it ), end_( end ),
+         value_( it != end ? it->first : 0 )
+        {}
+
+        const int &operator * () const { return value_; }
+
+        const_iterator &operator ++ ()
+        {
+            if ( value_ < it_->second )
+            {
+                ++value_;
+            }
+            else
+            {
+                ++it_;
+                value_ = ( it_ != end_ ) ? it_->first : 0;
+            }
+            return *this;
+        }
+
+        const_iterator operator ++ ( int )
+        {
+            const_iterator tmp( *this );
+            ++(*this);
+            return tmp;
+        }
+
+        bool operator == ( const const_iterator &it ) const { return it_ == it.it_ && value_ == it.value_; }
+        bool operator != ( const const_iterator &it ) const { return !( *this == it ); }
+
+    private:
+        Intervals::const_iterator it_, end_;
+        int value_;
+    };
+
+    typedef const_iterator iterator;
+
+public:
+    IntervalSet() : size_( 0 ) {}
+
+    bool insert( int value )
+    {
+        if ( count( value ) )
+            return false;
+        insert( value, value );
+        return true;
+    }
+
+    // inserts closed interval [first, last]
+    void insert( int first, int last )
+    {
+        if ( first > last )
+            return;
+
+        // find the leftmost interval, which overlaps or adjoins [first, last]
+        auto it = intervals_.upper_bound( first );
+        if ( it != intervals_.begin() )
+        {
+            auto it_prev = std::prev( it );
+            if ( it_prev->second >= first - 1 )
+                it = it_prev;
+        }
+
+        // merge with all overlapping or adjoining intervals
+        while( it != intervals_.end() && it->first - 1 <= last )
+        {
+            if ( it->first < first )
+                first = it->first;
+            if ( it->second > last )
+                last = it->second;
+            size_ -= Length( it );
+            intervals_.erase( it++ );
+        }
+
+        intervals_.emplace_hint( it, first, last );
+        size_ += static_cast< size_t >( last - first ) + 1;
+    }
+
+    size_t erase( int value )
+    {
+        auto it = FindInterval( value );
+        if ( it == intervals_.end() )
+            return 0;
+
+        const int first = it->first, last = it->second;
+        if ( first == value )
+        {
+            auto it_next = intervals_.erase( it );
+            if ( value < last )
+                intervals_.emplace_hint( it_next, value + 1, last );
+        }
+        else
+        {
+            it->second = value - 1;
+            if ( value < last )
+                intervals_.emplace_hint( std::next( it ), value + 1, last );
+        }
+        --size_;
+        return 1;
+    }
+
+    size_t count( int value ) const
+    {
+        return FindInterval( value ) != intervals_.end() ? 1 : 0;
+    }
+
+    const_iterator find( int value ) const
+    {
+        auto it = FindInterval( value );
+        if ( it == intervals_.end() )
+            return end();
+
+        const_iterator ret( it, intervals_.end() );
+        while( *ret != value )
+            ++ret;
+        return ret;
+    }
+
+    const_iterator begin() const { return const_iterator( intervals_.begin(), intervals_.end() ); }
+    const_iterator end() const { return const_iterator( intervals_.end(), intervals_.end() ); }
+
+    size_t size() const { return size_; }
+    bool empty() const { return intervals_.empty(); }
+
+    void clear()
+    {
+        intervals_.clear();
+        size_ = 0;
+    }
+
+    const Intervals &GetIntervals() const { return intervals_; }
+
+private:
+    Intervals::iterator FindInterval( int value )
+    {
+        auto it = intervals_.upper_bound( value );
+        if ( it == intervals_.begin() )
+            return intervals_.end();
+        --it;
+        return it->second >= value ? it : intervals_.end();
+    }
+
+    Intervals::const_iterator FindInterval( int value ) const
+    {
+        auto it = intervals_.upper_bound( value );
+        if ( it == intervals_.begin() )
+            return intervals_.end();
+        --it;
+        return it->second >= value ? it : intervals_.end();
+    }
+
+    static size_t Length( Intervals::const_iterator it )
+    {
+        return static_cast< size_t >( it->second - it->first ) + 1;
+    }
+
+private:
+    Intervals intervals_;
+    size_t size_;
+};
+
+} // namespace common
+
+#endif
@@ -26,9 +26,11 @@ the License.
 #include <string>
 #include <set>
 #include <list>
+#include <stdexcept>
 #include <stdint.h>
 #include <boost/property_tree/ptree.hpp>
 #include "log.h"
+#include "interval_set.h"
 
 namespace common {
 
@@ -64,6 +66,31 @@ public:
         return *this;
     }
 
+    // single values are written as numbers, longer intervals as [first, last] pairs
+    Marshaller &operator ()( const char *name, const IntervalSet &var )
+    {
+        Properties child;
+        for( const auto &interval : var.GetIntervals() )
+        {
+            Properties element;
+            if ( interval.first == interval.second )
+            {
+                element.put_value( interval.first );
+            }
+            else
+            {
+                Properties first, last;
+                first.put_value( interval.first );
+                last.put_value( interval.second );
+                element.push_back( std::make_pair( "", first ) );
+                element.push_back( std::make_pair( "", last ) );
+            }
+            child.push_back( std::make_pair( "", element ) );
+        }
+        ptree_.add_child( name, child );
+        return *this;
+    }
+
     const Properties &GetProperties() const { return ptree_; }
 
 private:
@@ -109,6 +136,37 @@ public:
         return *this;
     }
 
+    Demarshaller &operator ()( const char *name, IntervalSet &var )
+    {
+        try
+        {
+            for( const Properties::value_type &v: ptree_.get_child( name ) )
+            {
+                const Properties &element = v.second;
+                if ( element.empty() )
+                {
+                    var.insert( element.get_value< int >() );
+                }
+                else
+                {
+                    if ( element.size() != 2 )
+                        throw std::runtime_error( std::string( "invalid interval in " ) + name );
+
+                    auto it = element.begin();
+                    const int first = it->second.get_value< int >();
+                    const int last = (++it)->second.get_value< int >();
+                    var.insert( first, last );
+                }
+            }
+        }
+        catch( std::exception &e )
+        {
+            PLOG_ERR( "Demarshaller: " << e.what() );
+            throw;
+        }
+        return *this;
+    }
+
     Properties &GetProperties() { return ptree_; }
 
 protected:
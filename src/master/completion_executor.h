@@ -0,0 +1,85 @@
+/*
+===========================================================================
+
+This software is licensed under the Apache 2 license, quoted below.
+
+Copyright (C) 2013 Andrey Budnik <budnik27@gmail.com>
+
+Licensed under the Apache License, Version 2.0 (the "License"); you may not
+use this file except in compliance with the License. You may obtain a copy of
+the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+License for the specific language governing permissions and limitations under
+the License.
+
+===========================================================================
+*/
+
+#ifndef __COMPLETION_EXECUTOR_H
+#define __COMPLETION_EXECUTOR_H
+
+#include <functional>
+#include <memory>
+#include <boost/asio.hpp>
+#include "common/log.h"
+
+namespace master {
+
+struct ICompletionExecutor
+{
+    typedef std::function< void () > Effect;
+
+    virtual ~ICompletionExecutor() {}
+    virtual void Post( const Effect &effect ) = 0;
+};
+
+// Runs side effects of job completion (user callbacks, history deletion, cron requeue,
+// job group dependency release) outside of the scheduler locks. Effects are executed
+// one at a time in the order they were posted.
+class CompletionExecutor : public ICompletionExecutor
+{
+public:
+    CompletionExecutor( boost::asio::io_service &io_service )
+    : io_service_( io_service ), strand_( io_service )
+    {}
+
+    void Start()
+    {
+        work_.reset( new boost::asio::io_service::work( io_service_ ) );
+    }
+
+    // io_service thread exits after running all pending effects
+    void Stop()
+    {
+        work_.reset();
+    }
+
+    virtual void Post( const Effect &effect )
+    {
+        strand_.post( [effect]()
+        {
+            try
+            {
+                effect();
+            }
+            catch( const std::exception &e )
+            {
+                PLOG_ERR( "CompletionExecutor::Post: " << e.what() );
+            }
+        } );
+    }
+
+private:
+    boost::asio::io_service &io_service_;
+    boost::asio::io_service::strand strand_;
+    std::unique_ptr< boost::asio::io_service::work > work_;
+};
+
+} // namespace master
+
+#endif
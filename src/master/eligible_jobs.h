@@ -0,0 +1,171 @@
+/*
+===========================================================================
+
+This software is licensed under the Apache 2 license, quoted below.
+
+Copyright (C) 2013 Andrey Budnik <budnik27@gmail.com>
+
+Licensed under the Apache License, Version 2.0 (the "License"); you may not
+use this file except in compliance with the License. You may obtain a copy of
+the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+License for the specific language governing permissions and limitations under
+the License.
+
+===========================================================================
+*/
+
+#ifndef __ELIGIBLE_JOBS_H
+#define __ELIGIBLE_JOBS_H
+
+#include <set>
+#include <map>
+#include "job.h"
+#include "worker.h"
+
+namespace master {
+
+// Index of scheduled jobs that still have unsent tasks. Jobs are bucketed by
+// their host/group white lists, so only the jobs that may run on a given worker
+// are visited, in priority order.
+class EligibleJobs
+{
+    typedef std::set< JobPtr, JobPriorityOrder > JobSet;
+    typedef std::map< std::string, JobSet > KeyToJobs;
+
+public:
+    void Add( const JobPtr &job )
+    {
+        const std::set< std::string > &hosts = job->GetHosts();
+        const std::set< std::string > &groups = job->GetGroups();
+
+        if ( !hosts.empty() )
+        {
+            for( const auto &host : hosts )
+                byHost_[ host ].insert( job );
+        }
+        else
+        if ( !groups.empty() )
+        {
+            for( const auto &group : groups )
+                byGroup_[ group ].insert( job );
+        }
+        else
+        {
+            anyWorker_.insert( job );
+        }
+    }
+
+    void Remove( const JobPtr &job )
+    {
+        const std::set< std::string > &hosts = job->GetHosts();
+        const std::set< std::string > &groups = job->GetGroups();
+
+        if ( !hosts.empty() )
+        {
+            for( const auto &host : hosts )
+                Erase( byHost_, host, job );
+        }
+        else
+        if ( !groups.empty() )
+        {
+            for( const auto &group : groups )
+                Erase( byGroup_, group, job );
+        }
+        else
+        {
+            anyWorker_.erase( job );
+        }
+    }
+
+    // visits jobs, which may be executed on a worker, in priority order
+    // until visitor returns true
+    template< typename Visitor >
+    bool Visit( const WorkerPtr &worker, Visitor visitor ) const
+    {
+        JobSet::const_iterator it[3], end[3];
+        int num = 0;
+
+        if ( !anyWorker_.empty() )
+        {
+            it[ num ] = anyWorker_.begin();
+            end[ num++ ] = anyWorker_.end();
+        }
+
+        auto it_group = byGroup_.find( worker->GetGroup() );
+        if ( it_group != byGroup_.end() )
+        {
+            it[ num ] = it_group->second.begin();
+            end[ num++ ] = it_group->second.end();
+        }
+
+        auto it_host = byHost_.find( worker->GetHost() );
+        if ( it_host != byHost_.end() )
+        {
+            it[ num ] = it_host->second.begin();
+            end[ num++ ] = it_host->second.end();
+        }
+
+        JobPriorityOrder order;
+        while( true )
+        {
+            int top = -1;
+            for( int i = 0; i < num; ++i )
+            {
+                if ( it[i] == end[i] )
+                    continue;
+                if ( top < 0 || order( *it[i], *it[top] ) )
+                    top = i;
+            }
+
+            if ( top < 0 )
+                break;
+
+            if ( visitor( *it[top] ) )
+                return true;
+            ++it[top];
+        }
+        return false;
+    }
+
+    // jobs bound to hosts are assumed to be runnable in any group
+    bool HasJobs( const std::string &group ) const
+    {
+        return !anyWorker_.empty() || !byHost_.empty() ||
+            byGroup_.find( group ) != byGroup_.end();
+    }
+
+    void Clear()
+    {
+        anyWorker_.clear();
+        byGroup_.clear();
+        byHost_.clear();
+    }
+
+private:
+    static void Erase( KeyToJobs &index, const std::string &key, const JobPtr &job )
+    {
+        auto it = index.find( key );
+        if ( it != index.end() )
+        {
+            JobSet &jobs = it->second;
+            jobs.erase( job );
+            if ( jobs.empty() )
+                index.erase( it );
+        }
+    }
+
+private:
+    JobSet anyWorker_;  // jobs without host/group white lists
+    KeyToJobs byGroup_; // group -> jobs permitted only for the certain groups
+    KeyToJobs byHost_;  // host -> jobs permitted only for the certain hosts
+};
+
+} // namespace master
+
+#endif
@@ -25,24 +25,25 @@ the License.
 
 #include "common/log.h"
 #include "worker.h"
+#include "host_ids.h"
 
 namespace master {
 
 class FailedWorkers
 {
 public:
-    bool Add( int64_t jobId, const std::string &hostIP )
+    bool Add( int64_t jobId, uint32_t hostId )
     {
-        return failedWorkers_[ jobId ].insert( hostIP ).second;
+        return failedWorkers_[ jobId ].Insert( hostId );
     }
 
-    void Add( const WorkerJob &workerJob, const std::string &hostIP )
+    void Add( const WorkerJob &workerJob, uint32_t hostId )
     {
         std::set<int64_t> jobs;
         workerJob.GetJobs( jobs );
         for( auto jobId : jobs )
         {
-            failedWorkers_[ jobId ].insert( hostIP );
+            failedWorkers_[ jobId ].Insert( hostId );
         }
     }
 
@@ -51,7 +52,7 @@ public:
         auto it_failed = failedWorkers_.find( jobId );
         if ( it_failed != failedWorkers_.end() )
         {
-            size_t numFailed = it_failed->second.size();
+            size_t numFailed = it_failed->second.Size();
             failedWorkers_.erase( it_failed );
             PLOG( "FailedWorkers::Delete: jobId=" << jobId << ", num failed workers=" << numFailed );
             return true;
@@ -59,14 +60,13 @@ public:
         return false;
     }
 
-    bool IsWorkerFailedJob( const std::string &hostIP, int64_t jobId ) const
+    bool IsWorkerFailedJob( uint32_t hostId, int64_t jobId ) const
     {
         auto it = failedWorkers_.find( jobId );
         if ( it == failedWorkers_.end() )
             return false;
 
-        const std::set< std::string > &ips = it->second;
-        return ips.find( hostIP ) != ips.end();
+        return it->second.Contains( hostId );
     }
 
     size_t GetFailedNodesCnt( int64_t jobId ) const
@@ -75,7 +75,7 @@ public:
         if ( it == failedWorkers_.end() )
             return 0;
 
-        return it->second.size();
+        return it->second.Size();
     }
 
     size_t GetFailedJobsCnt() const
@@ -84,7 +84,7 @@ public:
     }
 
 private:
-    std::map< int64_t, std::set< std::string > > failedWorkers_; // job_id -> set(worker_ip)
+    std::map< int64_t, HostSet > failedWorkers_; // job_id -> set(worker_host_id)
 };
 
 } // namespace master
@@ -0,0 +1,180 @@
+/*
+===========================================================================
+
+This software is licensed under the Apache 2 license, quoted below.
+
+Copyright (C) 2013 Andrey Budnik <budnik27@gmail.com>
+
+Licensed under the Apache License, Version 2.0 (the "License"); you may not
+use this file except in compliance with the License. You may obtain a copy of
+the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+License for the specific language governing permissions and limitations under
+the License.
+
+===========================================================================
+*/
+
+#ifndef __FAIR_SHARE_H
+#define __FAIR_SHARE_H
+
+#include <string>
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <stdint.h> // int64_t
+
+namespace master {
+
+// Weighted fair share of the cluster between job queues. Usage of each queue is
+// accounted from the actual execution time of its tasks, separately for CPU and
+// memory, both normalized by the cluster capacity. The queue share is its
+// dominant (CPU or memory) usage divided by the queue weight. Usage decays
+// exponentially, so the past usage is forgotten with the given half-life.
+class FairShare
+{
+    typedef std::chrono::steady_clock Clock;
+
+    struct QueueUsage
+    {
+        QueueUsage() : cpu_( 0. ), memory_( 0. ), lastUpdate_( Clock::now() ) {}
+
+        double cpu_, memory_;
+        Clock::time_point lastUpdate_;
+    };
+
+    typedef std::map< std::string, QueueUsage > QueueToUsage;
+    typedef std::map< std::string, double > QueueToWeight;
+
+public:
+    FairShare()
+    : enabled_( false ), halfLife_( 3600 ), numCPU_( 0 ), memory_( 0 )
+    {}
+
+    void SetEnabled( bool enabled ) { enabled_ = enabled; }
+    bool IsEnabled() const { return enabled_; }
+
+    // half-life of the accounted usage in seconds
+    void SetHalfLife( int halfLife )
+    {
+        std::unique_lock< std::mutex > lock( mut_ );
+        halfLife_ = halfLife;
+    }
+
+    void SetWeight( const std::string &queue, double weight )
+    {
+        std::unique_lock< std::mutex > lock( mut_ );
+        weights_[ queue ] = weight;
+    }
+
+    double GetWeight( const std::string &queue ) const
+    {
+        std::unique_lock< std::mutex > lock( mut_ );
+        return GetQueueWeight( queue );
+    }
+
+    // total number of CPU's and memory size of the cluster
+    void SetCapacity( int64_t numCPU, int64_t memory )
+    {
+        std::unique_lock< std::mutex > lock( mut_ );
+        numCPU_ = numCPU;
+        memory_ = memory;
+    }
+
+    // accounts a single task execution, execTime in milliseconds
+    void AddUsage( const std::string &queue, int numCPU, int64_t memory, int64_t execTime )
+    {
+        if ( execTime <= 0 )
+            return;
+
+        std::unique_lock< std::mutex > lock( mut_ );
+        QueueUsage &usage = usage_[ queue ];
+        Decay( usage, Clock::now() );
+
+        if ( numCPU_ > 0 )
+            usage.cpu_ += static_cast< double >( numCPU ) * execTime / numCPU_;
+        if ( memory_ > 0 )
+            usage.memory_ += static_cast< double >( memory ) * execTime / memory_;
+    }
+
+    double GetShare( const std::string &queue ) const
+    {
+        std::unique_lock< std::mutex > lock( mut_ );
+        return GetQueueShare( queue, Clock::now() );
+    }
+
+    // returns true, if queue a is less served, than queue b
+    bool IsLessServed( const std::string &a, const std::string &b ) const
+    {
+        std::unique_lock< std::mutex > lock( mut_ );
+        const Clock::time_point now = Clock::now();
+        return GetQueueShare( a, now ) < GetQueueShare( b, now );
+    }
+
+    void Clear()
+    {
+        std::unique_lock< std::mutex > lock( mut_ );
+        usage_.clear();
+        weights_.clear();
+        numCPU_ = 0;
+        memory_ = 0;
+    }
+
+    static FairShare &Instance()
+    {
+        static FairShare instance_;
+        return instance_;
+    }
+
+private:
+    double GetQueueWeight( const std::string &queue ) const
+    {
+        auto it = weights_.find( queue );
+        if ( it != weights_.end() && it->second > 0. )
+            return it->second;
+        return 1.;
+    }
+
+    double GetQueueShare( const std::string &queue, const Clock::time_point &now ) const
+    {
+        auto it = usage_.find( queue );
+        if ( it == usage_.end() )
+            return 0.;
+
+        QueueUsage usage = it->second;
+        Decay( usage, now );
+        return std::max( usage.cpu_, usage.memory_ ) / GetQueueWeight( queue );
+    }
+
+    void Decay( QueueUsage &usage, const Clock::time_point &now ) const
+    {
+        if ( halfLife_ > 0 )
+        {
+            const double elapsed = std::chrono::duration< double >( now - usage.lastUpdate_ ).count();
+            const double factor = std::pow( 0.5, elapsed / halfLife_ );
+            usage.cpu_ *= factor;
+            usage.memory_ *= factor;
+        }
+        usage.lastUpdate_ = now;
+    }
+
+private:
+    bool enabled_;
+    int halfLife_;
+    int64_t numCPU_;
+    int64_t memory_;
+    QueueToUsage usage_;
+    QueueToWeight weights_;
+    mutable std::mutex mut_;
+};
+
+} // namespace master
+
+#endif
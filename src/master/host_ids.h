@@ -0,0 +1,98 @@
+/*
+===========================================================================
+
+This software is licensed under the Apache 2 license, quoted below.
+
+Copyright (C) 2013 Andrey Budnik <budnik27@gmail.com>
+
+Licensed under the Apache License, Version 2.0 (the "License"); you may not
+use this file except in compliance with the License. You may obtain a copy of
+the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+License for the specific language governing permissions and limitations under
+the License.
+
+===========================================================================
+*/
+
+
+#ifndef __HOST_IDS_H
+#define __HOST_IDS_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <stdint.h> // uint32_t
+
+namespace master {
+
+// Maps worker ip's to dense integer ids, so per-host state may be kept in
+// vectors and bitmaps instead of string-keyed maps. Ids are never released:
+// a worker, which reappears with the same ip, gets the same id.
+class HostIds
+{
+public:
+    static const uint32_t INVALID_ID = 0;
+
+public:
+    uint32_t Intern( const std::string &ip )
+    {
+        std::unique_lock< std::mutex > lock( mut_ );
+        auto it = ipToId_.find( ip );
+        if ( it != ipToId_.end() )
+            return it->second;
+
+        const uint32_t id = static_cast< uint32_t >( ipToId_.size() ) + 1;
+        ipToId_[ ip ] = id;
+        return id;
+    }
+
+    static HostIds &Instance()
+    {
+        static HostIds instance_;
+        return instance_;
+    }
+
+private:
+    std::unordered_map< std::string, uint32_t > ipToId_;
+    std::mutex mut_;
+};
+
+// Set of host ids, stored as a bitmap
+class HostSet
+{
+public:
+    HostSet() : size_( 0 ) {}
+
+    bool Insert( uint32_t id )
+    {
+        if ( id >= bits_.size() )
+            bits_.resize( id + 1 );
+        if ( bits_[ id ] )
+            return false;
+        bits_[ id ] = true;
+        ++size_;
+        return true;
+    }
+
+    bool Contains( uint32_t id ) const
+    {
+        return id < bits_.size() && bits_[ id ];
+    }
+
+    size_t Size() const { return size_; }
+
+private:
+    std::vector< bool > bits_;
+    size_t size_;
+};
+
+} // namespace master
+
+#endif
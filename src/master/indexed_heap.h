@@ -0,0 +1,172 @@
+/*
+===========================================================================
+
+This software is licensed under the Apache 2 license, quoted below.
+
+Copyright (C) 2013 Andrey Budnik <budnik27@gmail.com>
+
+Licensed under the Apache License, Version 2.0 (the "License"); you may not
+use this file except in compliance with the License. You may obtain a copy of
+the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+License for the specific language governing permissions and limitations under
+the License.
+
+===========================================================================
+*/
+
+#ifndef __INDEXED_HEAP_H
+#define __INDEXED_HEAP_H
+
+#include <vector>
+#include <unordered_map>
+#include <utility>
+#include <stdint.h> // int64_t
+
+namespace master {
+
+// Binary heap with elements addressed by id. Position of each element in the
+// heap is tracked, so an arbitrary element is erased or updated in O(log n).
+// Compare follows std::push_heap convention: the greatest element is on top.
+template< typename T, typename Compare >
+class IndexedHeap
+{
+public:
+    struct Entry
+    {
+        int64_t id_;
+        T value_;
+    };
+    typedef typename std::vector< Entry >::const_iterator const_iterator;
+
+public:
+    bool Push( int64_t id, const T &value )
+    {
+        if ( pos_.find( id ) != pos_.end() )
+            return false;
+
+        heap_.push_back( Entry{ id, value } );
+        pos_[ id ] = heap_.size() - 1;
+        SiftUp( heap_.size() - 1 );
+        return true;
+    }
+
+    const T &Top() const { return heap_.front().value_; }
+
+    void Pop()
+    {
+        Erase( heap_.front().id_ );
+    }
+
+    bool Erase( int64_t id )
+    {
+        auto it = pos_.find( id );
+        if ( it == pos_.end() )
+            return false;
+
+        const size_t i = it->second;
+        pos_.erase( it );
+
+        const size_t last = heap_.size() - 1;
+        if ( i != last )
+        {
+            heap_[i] = std::move( heap_[ last ] );
+            pos_[ heap_[i].id_ ] = i;
+        }
+        heap_.pop_back();
+
+        if ( i < heap_.size() )
+            Restore( i );
+        return true;
+    }
+
+    bool Update( int64_t id, const T &value )
+    {
+        auto it = pos_.find( id );
+        if ( it == pos_.end() )
+            return false;
+
+        heap_[ it->second ].value_ = value;
+        Restore( it->second );
+        return true;
+    }
+
+    // applies f to each element, then restores the heap order, O(n)
+    template< typename F >
+    void ModifyAll( F f )
+    {
+        for( auto &entry : heap_ )
+            f( entry.value_ );
+
+        for( size_t i = heap_.size() / 2; i-- > 0; )
+            SiftDown( i );
+    }
+
+    bool Contains( int64_t id ) const { return pos_.find( id ) != pos_.end(); }
+    bool Empty() const { return heap_.empty(); }
+    size_t Size() const { return heap_.size(); }
+
+    // elements in heap order, not sorted
+    const_iterator begin() const { return heap_.begin(); }
+    const_iterator end() const { return heap_.end(); }
+
+private:
+    void Restore( size_t i )
+    {
+        if ( i > 0 && compare_( heap_[ ( i - 1 ) / 2 ].value_, heap_[i].value_ ) )
+            SiftUp( i );
+        else
+            SiftDown( i );
+    }
+
+    void SiftUp( size_t i )
+    {
+        while( i > 0 )
+        {
+            const size_t parent = ( i - 1 ) / 2;
+            if ( !compare_( heap_[ parent ].value_, heap_[i].value_ ) )
+                break;
+            Swap( i, parent );
+            i = parent;
+        }
+    }
+
+    void SiftDown( size_t i )
+    {
+        const size_t size = heap_.size();
+        while( true )
+        {
+            size_t top = i;
+            const size_t left = 2 * i + 1, right = left + 1;
+            if ( left < size && compare_( heap_[ top ].value_, heap_[ left ].value_ ) )
+                top = left;
+            if ( right < size && compare_( heap_[ top ].value_, heap_[ right ].value_ ) )
+                top = right;
+            if ( top == i )
+                break;
+            Swap( i, top );
+            i = top;
+        }
+    }
+
+    void Swap( size_t i, size_t j )
+    {
+        std::swap( heap_[i], heap_[j] );
+        pos_[ heap_[i].id_ ] = i;
+        pos_[ heap_[j].id_ ] = j;
+    }
+
+private:
+    std::vector< Entry > heap_;
+    std::unordered_map< int64_t, size_t > pos_; // id -> position in heap_
+    Compare compare_;
+};
+
+} // namespace master
+
+#endif
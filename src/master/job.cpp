@@ -20,9 +20,12 @@ the License.
 ===========================================================================
 */
 
+#include <algorithm>
+#include <chrono>
 #include "job.h"
 #include "job_history.h"
 #include "job_manager.h"
+#include "fair_share.h"
 #include "common/log.h"
 #include "common/service_locator.h"
 
@@ -148,8 +151,7 @@ void JobQueue::PushJob( JobPtr &job, int64_t groupId )
     if ( !job->GetName().empty() )
         nameToJob_.emplace( job->GetName(), job );
 
-    jobs_.push_back( job );
-    std::push_heap( jobs_.begin(), jobs_.end(), JobComparatorPriority() );
+    Enqueue( job );
 }
 
 void JobQueue::PushJobs( std::list< JobPtr > &jobs, int64_t groupId )
@@ -176,8 +178,7 @@ void JobQueue::PushJobs( std::list< JobPtr > &jobs, int64_t groupId )
         }
         else
         {
-            jobs_.push_back( job );
-            std::push_heap( jobs_.begin(), jobs_.end(), JobComparatorPriority() );
+            Enqueue( job );
         }
     }
 }
@@ -213,16 +214,8 @@ bool JobQueue::DeleteJob( int64_t jobId )
 
     OnJobDeletion( job );
 
-    for( auto it = jobs_.begin(); it != jobs_.end(); ++it )
-    {
-        const JobPtr &job = *it;
-        if ( job->GetJobId() == jobId )
-        {
-            jobs_.erase( it );
-            std::make_heap( jobs_.begin(), jobs_.end(), JobComparatorPriority() );
-            return true;
-        }
-    }
+    if ( Dequeue( job ) )
+        return true;
 
     delayedJobs_.erase( job );
     return true;
@@ -277,10 +270,14 @@ bool JobQueue::DeleteJobGroup( int64_t groupId )
     JobList jobs;
     {
         std::unique_lock< std::recursive_mutex > lock( jobsMut_ );
-        for( const auto &job : jobs_ )
+        for( const auto &queue : jobs_ )
         {
-            if ( job->GetGroupId() == groupId )
-                jobs.push_back( job );
+            for( const auto &entry : queue.second )
+            {
+                const JobPtr &job = entry.value_.job_;
+                if ( job->GetGroupId() == groupId )
+                    jobs.push_back( job );
+            }
         }
         for( const auto &job : delayedJobs_ )
         {
@@ -320,7 +317,11 @@ void JobQueue::Clear()
     JobList jobs;
     {
         std::unique_lock< std::recursive_mutex > lock( jobsMut_ );
-        jobs = jobs_;
+        for( const auto &queue : jobs_ )
+        {
+            for( const auto &entry : queue.second )
+                jobs.push_back( entry.value_.job_ );
+        }
         jobs.insert( jobs.end(), delayedJobs_.begin(), delayedJobs_.end() );
         //std::copy( delayedJobs.begin(), delayedJobs.end(), std::back_inserter( jobs ) ); // less effective
     }
@@ -334,25 +335,126 @@ void JobQueue::Clear()
 bool JobQueue::PopJob( JobPtr &job )
 {
     std::unique_lock< std::recursive_mutex > lock( jobsMut_ );
-    if ( !jobs_.empty() )
+
+    auto it = SelectQueue();
+    if ( it != jobs_.end() )
     {
-        job = jobs_.front();
-        std::pop_heap( jobs_.begin(), jobs_.end(), JobComparatorPriority() );
-        jobs_.pop_back();
+        QueuedJobHeap &jobs = it->second;
+        const QueuedJob &top = jobs.Top();
+        job = top.job_;
+        waitTimeStat_.Add( job->GetPriority(), GetTimeMillis() - top.enqueueTime_ );
+
+        jobs.Pop();
+        if ( jobs.Empty() )
+            jobs_.erase( it );
         idToJob_.erase( job->GetJobId() );
         return true;
     }
     return false;
 }
 
+JobQueue::QueueToJobs::iterator JobQueue::SelectQueue()
+{
+    const FairShare &fairShare = FairShare::Instance();
+    QueuedJobComparator comparator;
+
+    auto top = jobs_.end();
+    for( auto it = jobs_.begin(); it != jobs_.end(); ++it )
+    {
+        if ( top == jobs_.end() )
+        {
+            top = it;
+            continue;
+        }
+
+        if ( fairShare.IsEnabled() )
+        {
+            // the least served queue first, then the most prioritized job
+            const double share = fairShare.GetShare( it->first );
+            const double topShare = fairShare.GetShare( top->first );
+            if ( share != topShare )
+            {
+                if ( share < topShare )
+                    top = it;
+                continue;
+            }
+        }
+
+        if ( comparator( top->second.Top(), it->second.Top() ) )
+            top = it;
+    }
+    return top;
+}
+
+void JobQueue::Enqueue( const JobPtr &job )
+{
+    QueuedJob queuedJob;
+    queuedJob.enqueueTime_ = GetTimeMillis();
+    queuedJob.key_ = GetQueueKey( job->GetPriority(), queuedJob.enqueueTime_ );
+    queuedJob.job_ = job;
+
+    QueuedJobHeap &jobs = jobs_[ job->GetQueue() ];
+    jobs.Push( job->GetJobId(), queuedJob );
+}
+
+bool JobQueue::Dequeue( const JobPtr &job )
+{
+    auto it_queue = jobs_.find( job->GetQueue() );
+    if ( it_queue == jobs_.end() )
+        return false;
+
+    QueuedJobHeap &jobs = it_queue->second;
+    if ( !jobs.Erase( job->GetJobId() ) )
+        return false;
+
+    if ( jobs.Empty() )
+        jobs_.erase( it_queue );
+    return true;
+}
+
+int64_t JobQueue::GetQueueKey( int priority, int64_t enqueueTime ) const
+{
+    if ( agingInterval_ > 0 )
+        return priority * agingInterval_ + enqueueTime;
+    return priority;
+}
+
+int64_t JobQueue::GetTimeMillis() const
+{
+    using namespace std::chrono;
+    return duration_cast< milliseconds >( steady_clock::now().time_since_epoch() ).count();
+}
+
+void JobQueue::SetPriorityAging( int64_t interval )
+{
+    std::unique_lock< std::recursive_mutex > lock( jobsMut_ );
+    if ( interval == agingInterval_ )
+        return;
+
+    // keys of the already queued jobs depend on the interval
+    agingInterval_ = interval;
+    for( auto &queue : jobs_ )
+    {
+        queue.second.ModifyAll( [this]( QueuedJob &queuedJob )
+        {
+            queuedJob.key_ = GetQueueKey( queuedJob.job_->GetPriority(), queuedJob.enqueueTime_ );
+        } );
+    }
+}
+
+void JobQueue::GetWaitTimeStat( WaitTimeStat &stat )
+{
+    std::unique_lock< std::recursive_mutex > lock( jobsMut_ );
+    stat = waitTimeStat_;
+}
+
 void JobQueue::OnJobDependenciesResolved( const JobPtr &job )
 {
     std::unique_lock< std::recursive_mutex > lock( jobsMut_ );
     auto it = delayedJobs_.find( job );
     if ( it != delayedJobs_.end() )
     {
-        jobs_.push_back( job );
-        std::push_heap( jobs_.begin(), jobs_.end(), JobComparatorPriority() );
+        Enqueue( job );
         delayedJobs_.erase( it );
     }
     else
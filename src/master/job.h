@@ -24,6 +24,8 @@ the License.
 #define __JOB_H
 
 #include <list>
+#include <set>
+#include <map>
 #include <vector>
 #include <mutex>
 #include <memory>
@@ -31,13 +33,16 @@ the License.
 #include <boost/graph/adjacency_list.hpp>
 #include <stdint.h> // int64_t
 #include "common/cron.h"
+#include "wait_time_stat.h"
+#include "indexed_heap.h"
 
 namespace master {
 
 enum JobFlag
 {
     JOB_FLAG_NO_RESCHEDULE = 1,
-    JOB_FLAG_EXCLUSIVE = 2
+    JOB_FLAG_EXCLUSIVE = 2,
+    JOB_FLAG_GANG = 4
 };
 
 enum class ExecUnitType
@@ -104,10 +109,10 @@ public:
          int maxClusterInstances, int maxWorkerInstances,
          int timeout, int queueTimeout, int taskTimeout,
          bool exclusive, bool noReschedule )
-    : script_( script ), scriptLanguage_( scriptLanguage ),
+    : script_( script ), scriptLanguage_( scriptLanguage ), queue_( "default" ),
      priority_( priority ), numDepends_( 0 ), maxFailedNodes_( maxFailedNodes ),
      numExec_( numExec ), maxClusterInstances_( maxClusterInstances ), maxWorkerInstances_( maxWorkerInstances ),
-     maxExecAtWorker_( -1 ),
+     maxExecAtWorker_( -1 ), taskMemory_( 0 ),
      timeout_( timeout ), queueTimeout_( queueTimeout ), taskTimeout_( taskTimeout ),
      flags_( 0 ), execUnitType_( ExecUnitType::CPU ), id_( -1 ), groupId_( -1 )
     {
@@ -129,6 +134,8 @@ public:
     const std::string &GetName() const { return name_; }
     const std::string &GetAlias() const { return alias_; }
     const std::string &GetDescription() const { return description_; }
+    const std::string &GetQueue() const { return queue_; }
+    const std::string &GetDataSet() const { return dataSet_; }
     int GetPriority() const { return priority_; }
     int GetNumDepends() const { return numDepends_; }
     int GetNumPlannedExec() const { return numPlannedExec_; }
@@ -137,11 +144,13 @@ public:
     int GetMaxClusterInstances() const { return maxClusterInstances_; }
     int GetMaxWorkerInstances() const { return maxWorkerInstances_; }
     int GetMaxExecAtWorker() const { return maxExecAtWorker_; }
+    int64_t GetTaskMemory() const { return taskMemory_; }
     int GetTimeout() const { return timeout_; }
     int GetQueueTimeout() const { return queueTimeout_; }
     int GetTaskTimeout() const { return taskTimeout_; }
     bool IsNoReschedule() const { return flags_ & JOB_FLAG_NO_RESCHEDULE; }
     bool IsExclusive() const { return flags_ & JOB_FLAG_EXCLUSIVE; }
+    bool IsGang() const { return flags_ & JOB_FLAG_GANG; }
     ExecUnitType GetExecUnitType() const { return execUnitType_; }
     int64_t GetJobId() const { return id_; }
     int64_t GetGroupId() const { return groupId_; }
@@ -152,7 +161,11 @@ public:
     void SetName( const std::string &name ) { name_ = name; }
     void SetAlias( const std::string &alias ) { alias_ = alias; }
     void SetDescription( const std::string &description ) { description_ = description; }
+    void SetQueue( const std::string &queue ) { queue_ = queue; }
+    void SetDataSet( const std::string &dataSet ) { dataSet_ = dataSet; }
+    void SetGang( bool gang ) { flags_ = gang ? ( flags_ | JOB_FLAG_GANG ) : ( flags_ & ~JOB_FLAG_GANG ); }
     void SetMaxExecAtWorker( int val ) { maxExecAtWorker_ = val; }
+    void SetTaskMemory( int64_t val ) { taskMemory_ = val; }
     void SetNumPlannedExec( int val ) { numPlannedExec_ = val; }
     void SetNumDepends( int val ) { numDepends_ = val; }
     void SetExecUnitType( ExecUnitType type ) { execUnitType_ = type; }
@@ -165,10 +178,12 @@ public:
     void AddHostToBlacklist( const std::string &host );
     bool IsHostPermitted( const std::string &host ) const;
     size_t GetNumPermittedHosts() const;
+    const std::set< std::string > &GetHosts() const { return hosts_; }
 
     void AddGroup( const std::string &group );
     void AddGroupToBlacklist( const std::string &group );
     bool IsGroupPermitted( const std::string &group ) const;
+    const std::set< std::string > &GetGroups() const { return groups_; }
 
     template< typename T, typename U >
     void SetCallback( T *obj, void (U::*f)( const std::string &method, const boost::property_tree::ptree &params ) )
@@ -190,6 +205,8 @@ private:
     std::string name_;
     std::string alias_;
     std::string description_;
+    std::string queue_; // fair share queue
+    std::string dataSet_; // name of the data set, read by the job tasks
 
     int priority_;
     int numDepends_;
@@ -199,6 +216,7 @@ private:
     int maxClusterInstances_;
     int maxWorkerInstances_;
     int maxExecAtWorker_;
+    int64_t taskMemory_; // memory, required by a single task in MB
     int timeout_, queueTimeout_, taskTimeout_;
     int flags_;
     ExecUnitType execUnitType_;
@@ -231,6 +249,20 @@ struct JobComparatorPriority
     }
 };
 
+// strict ordering of jobs by priority, job group and job id.
+// the smaller a job, the earlier it must be scheduled
+struct JobPriorityOrder
+{
+    bool operator() ( const JobPtr &a, const JobPtr &b ) const
+    {
+        if ( a->GetPriority() != b->GetPriority() )
+            return a->GetPriority() < b->GetPriority();
+        if ( a->GetGroupId() != b->GetGroupId() )
+            return a->GetGroupId() < b->GetGroupId();
+        return a->GetJobId() < b->GetJobId();
+    }
+};
+
 
 class IJobQueue
 {
@@ -251,16 +283,50 @@ public:
     virtual bool DeleteJob( int64_t jobId ) = 0;
     virtual bool DeleteJobGroup( int64_t groupId ) = 0;
     virtual void Clear() = 0;
+
+    virtual void SetPriorityAging( int64_t interval ) = 0;
+    virtual void GetWaitTimeStat( WaitTimeStat &stat ) = 0;
 };
 
 class JobQueue : public IJobQueue
 {
+    // Queued job ordering key. Effective priority of a job rises by one every
+    // aging interval, i.e. it equals priority - (now - enqueueTime) / interval.
+    // Ordering by the effective priority is the same as ordering by
+    // priority * interval + enqueueTime, which doesn't depend on current time,
+    // so the heap never needs to be rebuilt.
+    struct QueuedJob
+    {
+        int64_t key_;
+        int64_t enqueueTime_;
+        JobPtr job_;
+    };
+
+    struct QueuedJobComparator
+    {
+        bool operator() ( const QueuedJob &a, const QueuedJob &b ) const
+        {
+            if ( a.key_ > b.key_ )
+                return true;
+            if ( a.key_ == b.key_ )
+            {
+                if ( a.job_->GetGroupId() > b.job_->GetGroupId() )
+                    return true;
+            }
+            return false;
+        }
+    };
+
     typedef std::map< int64_t, JobPtr > IdToJob;
     typedef std::vector< JobPtr > JobList;
+    typedef IndexedHeap< QueuedJob, QueuedJobComparator > QueuedJobHeap; // job_id -> queued job
+    typedef std::map< std::string, QueuedJobHeap > QueueToJobs; // queue -> heap of jobs
     typedef std::set< JobPtr > JobSet;
     typedef std::multimap< std::string, JobPtr > JobNameToJob;
 
 public:
+    JobQueue() : agingInterval_( 0 ) {}
+
     virtual void PushJob( JobPtr &job, int64_t groupId );
     virtual void PushJobs( std::list< JobPtr > &jobs, int64_t groupId );
 
@@ -276,12 +342,24 @@ public:
     virtual bool DeleteJobGroup( int64_t groupId );
     virtual void Clear();
 
+    // interval in milliseconds, zero disables aging
+    virtual void SetPriorityAging( int64_t interval );
+    virtual void GetWaitTimeStat( WaitTimeStat &stat );
+
 private:
+    void Enqueue( const JobPtr &job );
+    bool Dequeue( const JobPtr &job );
+    QueueToJobs::iterator SelectQueue();
+    int64_t GetQueueKey( int priority, int64_t enqueueTime ) const;
+    int64_t GetTimeMillis() const;
+
     void OnJobDeletion( JobPtr &job );
     void ReleaseMetaJobName( const std::string &metaJobName, int64_t jobId );
 
 private:
-    JobList jobs_;
+    QueueToJobs jobs_;
+    int64_t agingInterval_;
+    WaitTimeStat waitTimeStat_;
     JobSet delayedJobs_; // jobs with unresolved dependencies
     IdToJob idToJob_;
     JobNameToJob nameToJob_;
@@ -379,6 +379,11 @@ bool JobManager::PopJob( JobPtr &job )
     return jobs_->PopJob( job );
 }
 
+void JobManager::GetWaitTimeStat( WaitTimeStat &stat )
+{
+    jobs_->GetWaitTimeStat( stat );
+}
+
 bool JobManager::RegisterJobName( const std::string &name )
 {
     if ( name.empty() )
@@ -452,6 +457,12 @@ JobManager &JobManager::SetExeDir( const std::string &exeDir )
     return *this;
 }
 
+JobManager &JobManager::SetPriorityAging( int64_t interval )
+{
+    jobs_->SetPriorityAging( interval );
+    return *this;
+}
+
 void JobManager::Shutdown()
 {
     jobs_->Clear();
@@ -527,6 +538,36 @@ Job *JobManager::CreateJob( const boost::property_tree::ptree &ptree )
             job->SetMaxExecAtWorker( value );
         }
 
+        if ( ptree.count( "task_memory" ) > 0 )
+        {
+            int64_t value = ptree.get<int64_t>( "task_memory" );
+            if ( value < 0 )
+                throw std::runtime_error( std::string( "negative task_memory" ) );
+            job->SetTaskMemory( value );
+        }
+
+        if ( ptree.count( "queue" ) > 0 )
+        {
+            std::string value = ptree.get<std::string>( "queue" );
+            if ( value.empty() )
+                throw std::runtime_error( std::string( "empty queue name" ) );
+            job->SetQueue( value );
+        }
+
+        if ( ptree.count( "data_set" ) > 0 )
+        {
+            std::string value = ptree.get<std::string>( "data_set" );
+            if ( value.empty() )
+                throw std::runtime_error( std::string( "empty data_set name" ) );
+            job->SetDataSet( value );
+        }
+
+        if ( ptree.count( "gang" ) > 0 )
+        {
+            bool value = ptree.get<bool>( "gang" );
+            job->SetGang( value );
+        }
+
         if ( ptree.count( "exec_unit_type" ) > 0 )
         {
             std::string value = ptree.get<std::string>( "exec_unit_type" );
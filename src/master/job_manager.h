@@ -61,6 +61,8 @@ struct IJobManager
 
     virtual bool PopJob( JobPtr &job ) = 0;
 
+    virtual void GetWaitTimeStat( WaitTimeStat &stat ) = 0;
+
     virtual bool RegisterJobName( const std::string &name ) = 0;
     virtual bool ReleaseJobName( const std::string &name ) = 0;
 
@@ -90,6 +92,8 @@ public:
 
     virtual bool PopJob( JobPtr &job );
 
+    virtual void GetWaitTimeStat( WaitTimeStat &stat );
+
     virtual bool RegisterJobName( const std::string &name );
     virtual bool ReleaseJobName( const std::string &name );
 
@@ -102,6 +106,7 @@ public:
     JobManager &SetTimeoutManager( ITimeoutManager *timeoutManager );
     JobManager &SetMasterId( const std::string &masterId );
     JobManager &SetExeDir( const std::string &exeDir );
+    JobManager &SetPriorityAging( int64_t interval );
 
     void Shutdown();
 
@@ -33,13 +33,13 @@ namespace master {
 
 void JobSender::Run()
 {
-    WorkerJob workerJob;
-    std::string hostIP;
-    JobPtr job;
+    TasksToSend tasks;
 
     IScheduler *scheduler = common::GetService< IScheduler >();
     scheduler->Subscribe( this );
 
+    const size_t maxBatchSize = maxBatchSize_ > 0 ? maxBatchSize_ : 1;
+
     bool getTask = false;
     while( !stopped_ )
     {
@@ -51,13 +51,15 @@ void JobSender::Run()
             newJobAvailable_ = false;
         }
 
-        getTask = scheduler->GetTaskToSend( workerJob, hostIP, job );
-        if ( getTask )
+        // take a batch of tasks in one scheduler lock acquisition,
+        // each task is sent asynchronously
+        getTask = scheduler->GetTasksToSend( tasks, maxBatchSize );
+        for( auto &task : tasks )
         {
-            PLOG( "Send job " << workerJob.GetJobId() << " to " << hostIP );
-            SendJob( workerJob, hostIP, job );
-            workerJob.Reset();
+            PLOG( "Send job " << task.workerJob_.GetJobId() << " to " << task.hostIP_ );
+            SendJob( task.workerJob_, task.hostIP_, task.job_ );
         }
+        tasks.clear();
     }
 }
 
@@ -113,7 +115,10 @@ void JobSenderBoost::Stop()
 
 void JobSenderBoost::SendJob( const WorkerJob &workerJob, const std::string &hostIP, JobPtr &job )
 {   
+    const int64_t start = SchedulerStat::GetTimeMicros();
     sendJobsSem_.Wait();
+    IScheduler *scheduler = common::GetService< IScheduler >();
+    scheduler->GetStat().Add( SchedulerStat::SEND_QUEUE_WAIT, SchedulerStat::GetTimeMicros() - start );
 
     SenderBoost::sender_ptr sender(
         new SenderBoost( io_service_, this, workerJob, hostIP, job )
@@ -219,6 +224,9 @@ void SenderBoost::OnCompletion( bool success )
             completed_ = true;
     }
 
+    IScheduler *scheduler = common::GetService< IScheduler >();
+    scheduler->GetStat().Add( SchedulerStat::SEND_TIME, SchedulerStat::GetTimeMicros() - startTime_ );
+
     sender_->OnJobSendCompletion( success, workerJob_, hostIP_, job_ );
 }
 
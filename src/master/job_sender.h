@@ -32,6 +32,7 @@ the License.
 #include "job.h"
 #include "worker.h"
 #include "timeout_manager.h"
+#include "scheduler_stat.h"
 
 using boost::asio::ip::tcp;
 
@@ -40,9 +41,9 @@ namespace master {
 class JobSender : common::IObserver
 {
 public:
-    JobSender( TimeoutManager *timeoutManager )
+    JobSender( TimeoutManager *timeoutManager, int maxBatchSize )
     : stopped_( false ), timeoutManager_( timeoutManager ),
-     newJobAvailable_( false )
+     maxBatchSize_( maxBatchSize ), newJobAvailable_( false )
     {}
 
     virtual void Start() = 0;
@@ -62,6 +63,7 @@ private:
 private:
     bool stopped_;
     TimeoutManager *timeoutManager_;
+    int maxBatchSize_;
     std::mutex awakeMut_;
     std::condition_variable awakeCond_;
     bool newJobAvailable_;
@@ -79,7 +81,7 @@ public:
     : socket_( io_service ),
      sender_( sender ), workerJob_( workerJob ),
      hostIP_( hostIP ), job_( job ),
-     completed_( false )
+     completed_( false ), startTime_( SchedulerStat::GetTimeMicros() )
     {}
 
     void Send();
@@ -108,6 +110,7 @@ private:
     JobPtr job_;
     bool completed_;
     std::mutex completionMut_;
+    int64_t startTime_; // us
 };
 
 class JobSenderBoost : public JobSender
@@ -116,7 +119,7 @@ public:
     JobSenderBoost( boost::asio::io_service &io_service,
                     TimeoutManager *timeoutManager,
                     int maxSimultSendingJobs )
-    : JobSender( timeoutManager ),
+    : JobSender( timeoutManager, maxSimultSendingJobs ),
      io_service_( io_service ),
      sendJobsSem_( maxSimultSendingJobs )
     {}
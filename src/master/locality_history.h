@@ -0,0 +1,85 @@
+/*
+===========================================================================
+
+This software is licensed under the Apache 2 license, quoted below.
+
+Copyright (C) 2013 Andrey Budnik <budnik27@gmail.com>
+
+Licensed under the Apache License, Version 2.0 (the "License"); you may not
+use this file except in compliance with the License. You may obtain a copy of
+the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+License for the specific language governing permissions and limitations under
+the License.
+
+===========================================================================
+*/
+
+
+#ifndef __LOCALITY_HISTORY_H
+#define __LOCALITY_HISTORY_H
+
+#include <string>
+#include <map>
+#include <algorithm>
+#include <stdint.h> // int64_t
+
+namespace master {
+
+// Hosts, which recently executed tasks with the same locality key (data set,
+// job name or script path). Only the most recent hosts are kept per key.
+class LocalityHistory
+{
+    typedef std::map< uint32_t, int64_t > HostToTime; // host_id -> last exec time
+    typedef std::map< std::string, HostToTime > KeyToHosts;
+
+public:
+    static const size_t MAX_HOSTS = 64;
+
+public:
+    void Add( const std::string &key, uint32_t hostId, int64_t time )
+    {
+        HostToTime &hosts = keyToHosts_[ key ];
+        hosts[ hostId ] = time;
+
+        if ( hosts.size() > MAX_HOSTS )
+        {
+            auto oldest = std::min_element( hosts.begin(), hosts.end(),
+                []( const HostToTime::value_type &a, const HostToTime::value_type &b )
+                {
+                    return a.second < b.second;
+                } );
+            hosts.erase( oldest );
+        }
+    }
+
+    bool HasLocality( const std::string &key ) const
+    {
+        return keyToHosts_.find( key ) != keyToHosts_.end();
+    }
+
+    bool IsLocal( const std::string &key, uint32_t hostId ) const
+    {
+        auto it = keyToHosts_.find( key );
+        if ( it == keyToHosts_.end() )
+            return false;
+        return it->second.find( hostId ) != it->second.end();
+    }
+
+    void Clear()
+    {
+        keyToHosts_.clear();
+    }
+
+private:
+    KeyToHosts keyToHosts_;
+};
+
+} // namespace master
+
+#endif
@@ -43,11 +43,13 @@ the License.
 #include "job_history.h"
 #include "worker_manager.h"
 #include "scheduler.h"
+#include "fair_share.h"
 #include "job_sender.h"
 #include "result_getter.h"
 #include "command_sender.h"
 #include "timeout_manager.h"
 #include "cron_manager.h"
+#include "completion_executor.h"
 #include "admin.h"
 #include "defines.h"
 #include "test.h"
@@ -222,11 +224,34 @@ public:
         serviceLocator.Register( static_cast< master::ICronManager* >( cronManager_.get() ) );
 
         jobManager_ = make_shared<master::JobManager>();
-        jobManager_->SetMasterId( masterId_ ).SetExeDir( exeDir_ ).SetTimeoutManager( timeoutManager_.get() );
+        jobManager_->SetMasterId( masterId_ ).SetExeDir( exeDir_ ).SetTimeoutManager( timeoutManager_.get() )
+            .SetPriorityAging( 1000 * cfg.Get<int64_t>( "priority_aging_interval" ) );
         serviceLocator.Register( static_cast< master::IJobManager* >( jobManager_.get() ) );
 
+        completionExecutor_ = make_shared<master::CompletionExecutor>( io_service_completion_ );
+
         scheduler_ = make_shared<master::Scheduler>();
+        scheduler_->SetCompletionExecutor( completionExecutor_.get() );
         serviceLocator.Register( static_cast< master::IScheduler* >( scheduler_.get() ) );
+        {
+            auto policyName = cfg.Get<std::string>( "placement_policy" );
+            master::PlacementPolicy policy;
+            if ( master::ParsePlacementPolicy( policyName, policy ) )
+            {
+                scheduler_->SetPlacementPolicy( policy );
+            }
+            else
+            {
+                PLOG_ERR( "MasterApplication::Initialize: unknown placement_policy: " << policyName );
+            }
+        }
+        scheduler_->SetBackfill( cfg.Get<bool>( "backfill" ) );
+        scheduler_->SetSpeculativeExecution( cfg.Get<bool>( "speculative_execution" ) );
+        scheduler_->SetGangTimeout( cfg.Get<int>( "gang_reservation_timeout" ) );
+        scheduler_->SetPreemptionBudget( cfg.Get<int>( "preemption_budget" ) );
+        scheduler_->SetLocalityDelay( cfg.Get<int>( "locality_delay" ) );
+        scheduler_->SetPlanningWindow( cfg.Get<int>( "planning_window" ) );
+        InitFairShare( cfg );
 
         InitHistory();
 
@@ -240,6 +265,9 @@ public:
         cronManager_->Start();
         worker_threads_.emplace_back( ThreadFun, &io_service_cron_ );
 
+        completionExecutor_->Start();
+        completion_thread_ = std::thread( ThreadFun, &io_service_completion_ );
+
         // start ping from nodes receiver threads
         pingReceiver_ = make_shared<master::PingReceiverBoost>( io_service_ping_ );
         pingReceiver_->Start();
@@ -327,6 +355,13 @@ public:
         if ( commandSender_ )
             commandSender_->Stop();
 
+        // run pending job completion effects before history shutdown
+        if ( completionExecutor_ )
+            completionExecutor_->Stop();
+
+        if ( completion_thread_.joinable() )
+            completion_thread_.join();
+
         if ( history_ )
             history_->Shutdown();
 
@@ -401,6 +436,38 @@ private:
         cfg.Insert( "node_ping_port", master::NODE_UDP_PORT );
         cfg.Insert( "master_ping_port", master::MASTER_UDP_PORT );
         cfg.Insert( "master_admin_port", master::MASTER_ADMIN_PORT );
+        cfg.Insert( "placement_policy", std::string( "spread" ) );
+        cfg.Insert( "fair_share", false );
+        cfg.Insert( "fair_share_half_life", 3600 );
+        cfg.Insert( "priority_aging_interval", 0 );
+        cfg.Insert( "backfill", false );
+        cfg.Insert( "speculative_execution", false );
+        cfg.Insert( "gang_reservation_timeout", 60 );
+        cfg.Insert( "preemption_budget", 0 );
+        cfg.Insert( "locality_delay", 0 );
+        cfg.Insert( "planning_window", 1 );
+    }
+
+    void InitFairShare( const common::Config &cfg ) const
+    {
+        master::FairShare &fairShare = master::FairShare::Instance();
+        fairShare.SetEnabled( cfg.Get<bool>( "fair_share" ) );
+        fairShare.SetHalfLife( cfg.Get<int>( "fair_share_half_life" ) );
+
+        boost::property_tree::ptree weights;
+        if ( cfg.GetChild( "queue_weights", weights ) )
+        {
+            for( const auto &v : weights )
+            {
+                const double weight = v.second.get_value< double >();
+                if ( weight <= 0. )
+                {
+                    PLOG_ERR( "MasterApplication::InitFairShare: non-positive weight of queue " << v.first );
+                    continue;
+                }
+                fairShare.SetWeight( v.first, weight );
+            }
+        }
     }
 
     void InitHistory()
@@ -472,6 +539,7 @@ private:
     common::SharedLibrary historyLibrary_;
 
     std::vector<std::thread> worker_threads_;
+    std::thread completion_thread_;
 
     boost::asio::io_service io_service_timeout_;
     boost::asio::io_service io_service_cron_;
@@ -480,6 +548,7 @@ private:
     boost::asio::io_service io_service_getters_;
     boost::asio::io_service io_service_command_send_;
     boost::asio::io_service io_service_admin_;
+    boost::asio::io_service io_service_completion_;
 
     std::shared_ptr< master::JobManager > jobManager_;
     std::shared_ptr< master::JobHistory > jobHistory_;
@@ -487,6 +556,7 @@ private:
     std::shared_ptr< master::Scheduler > scheduler_;
     std::shared_ptr< master::TimeoutManager > timeoutManager_;
     std::shared_ptr< master::CronManager > cronManager_;
+    std::shared_ptr< master::CompletionExecutor > completionExecutor_;
 
     common::IHistory *history_;
     void ( *historyDestroy_ )( const common::IHistory * );
@@ -0,0 +1,178 @@
+/*
+===========================================================================
+
+This software is licensed under the Apache 2 license, quoted below.
+
+Copyright (C) 2013 Andrey Budnik <budnik27@gmail.com>
+
+Licensed under the Apache License, Version 2.0 (the "License"); you may not
+use this file except in compliance with the License. You may obtain a copy of
+the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+License for the specific language governing permissions and limitations under
+the License.
+
+===========================================================================
+*/
+
+#ifndef __NODE_INDEX_H
+#define __NODE_INDEX_H
+
+#include <vector>
+#include <stdint.h> // uint64_t
+#include "node_state.h"
+
+namespace master {
+
+// Nodes, bucketed by the number of free CPU's. Each bucket is an intrusive
+// FIFO list, threaded through NodeState, and a bitmap tracks non-empty buckets,
+// so a node update is O(1) and the most/least free node lookup costs a scan of
+// the bitmap words, i.e. O(1) for realistic CPU counts. Nodes without free
+// CPU's are kept in the bucket 0.
+class NodeIndex
+{
+    struct Bucket
+    {
+        Bucket() : head_( nullptr ), tail_( nullptr ) {}
+
+        NodeState *head_;
+        NodeState *tail_;
+    };
+
+public:
+    NodeIndex() : size_( 0 ) {}
+
+    // inserts the node or moves it to the bucket of its current free CPU count
+    void Update( NodeState *node )
+    {
+        const int bucket = GetBucket( node );
+        if ( node->indexBucket_ == bucket )
+            return;
+
+        if ( node->indexBucket_ >= 0 )
+            Unlink( node );
+        else
+            ++size_;
+        Link( node, bucket );
+    }
+
+    void Erase( NodeState *node )
+    {
+        if ( node->indexBucket_ < 0 )
+            return;
+
+        Unlink( node );
+        node->indexBucket_ = -1;
+        --size_;
+    }
+
+    // the greatest free CPU count among the nodes, zero if all nodes are busy
+    int GetMaxFreeCPU() const
+    {
+        for( size_t i = bits_.size(); i-- > 0; )
+        {
+            if ( bits_[i] )
+                return i * 64 + 63 - __builtin_clzll( bits_[i] );
+        }
+        return 0;
+    }
+
+    // the nearest non-empty bucket above the given one, zero if none
+    int GetNextBucket( int bucket ) const
+    {
+        int i = bucket + 1;
+        for( size_t w = i / 64; w < bits_.size(); ++w, i = w * 64 )
+        {
+            const uint64_t bits = bits_[w] & ( ~uint64_t( 0 ) << ( i % 64 ) );
+            if ( bits )
+                return w * 64 + __builtin_ctzll( bits );
+        }
+        return 0;
+    }
+
+    // the nearest non-empty bucket below the given one, zero if none
+    int GetPrevBucket( int bucket ) const
+    {
+        if ( bucket <= 1 )
+            return 0;
+
+        int i = bucket - 1;
+        for( int w = i / 64; w >= 0; --w, i = w * 64 + 63 )
+        {
+            const uint64_t bits = bits_[w] & ( ~uint64_t( 0 ) >> ( 63 - i % 64 ) );
+            if ( bits )
+                return w * 64 + 63 - __builtin_clzll( bits );
+        }
+        return 0;
+    }
+
+    NodeState *GetFirst( int bucket ) const
+    {
+        return bucket < static_cast< int >( buckets_.size() ) ? buckets_[ bucket ].head_ : nullptr;
+    }
+
+    static NodeState *GetNext( const NodeState *node ) { return node->nextNode_; }
+
+    size_t Size() const { return size_; }
+    bool Empty() const { return size_ == 0; }
+
+private:
+    static int GetBucket( const NodeState *node )
+    {
+        const int numFreeCPU = node->GetNumFreeCPU();
+        return numFreeCPU > 0 ? numFreeCPU : 0;
+    }
+
+    void Link( NodeState *node, int bucket )
+    {
+        if ( bucket >= static_cast< int >( buckets_.size() ) )
+        {
+            buckets_.resize( bucket + 1 );
+            bits_.resize( bucket / 64 + 1, 0 );
+        }
+
+        Bucket &b = buckets_[ bucket ];
+        node->prevNode_ = b.tail_;
+        node->nextNode_ = nullptr;
+        if ( b.tail_ )
+            b.tail_->nextNode_ = node;
+        else
+            b.head_ = node;
+        b.tail_ = node;
+
+        node->indexBucket_ = bucket;
+        bits_[ bucket / 64 ] |= uint64_t( 1 ) << ( bucket % 64 );
+    }
+
+    void Unlink( NodeState *node )
+    {
+        const int bucket = node->indexBucket_;
+        Bucket &b = buckets_[ bucket ];
+        if ( node->prevNode_ )
+            node->prevNode_->nextNode_ = node->nextNode_;
+        else
+            b.head_ = node->nextNode_;
+        if ( node->nextNode_ )
+            node->nextNode_->prevNode_ = node->prevNode_;
+        else
+            b.tail_ = node->prevNode_;
+        node->prevNode_ = node->nextNode_ = nullptr;
+
+        if ( !b.head_ )
+            bits_[ bucket / 64 ] &= ~( uint64_t( 1 ) << ( bucket % 64 ) );
+    }
+
+private:
+    std::vector< Bucket > buckets_; // free CPU count -> nodes
+    std::vector< uint64_t > bits_; // bit i is set if buckets_[i] isn't empty
+    size_t size_;
+};
+
+} // namespace master
+
+#endif
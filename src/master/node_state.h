@@ -23,35 +23,64 @@ the License.
 #ifndef __NODE_STATE_H
 #define __NODE_STATE_H
 
+#include <algorithm>
 #include "worker.h"
 
 namespace master {
 
+class NodeIndex;
+
 class NodeState
 {
+    friend class NodeIndex;
+
 public:
     NodeState()
-    : numBusyCPU_( 0 )
+    : numBusyCPU_( 0 ), busyMemory_( 0 ), drainTime_( 0 ),
+     prevNode_( nullptr ), nextNode_( nullptr ), indexBucket_( -1 )
     {}
 
     void Reset()
     {
         numBusyCPU_ = 0;
+        busyMemory_ = 0;
+        drainTime_ = 0;
     }
 
     void AllocCPU( int numCPU ) { numBusyCPU_ += numCPU; }
-    void FreeCPU( int numCPU ) { numBusyCPU_ -= numCPU; }
+    void FreeCPU( int numCPU )
+    {
+        numBusyCPU_ -= numCPU;
+        if ( numBusyCPU_ <= 0 )
+            drainTime_ = 0;
+    }
+
+    void AllocMemory( int64_t memSizeMb ) { busyMemory_ += memSizeMb; }
+    void FreeMemory( int64_t memSizeMb ) { busyMemory_ -= memSizeMb; }
 
     int GetNumBusyCPU() const { return numBusyCPU_; }
     int GetNumFreeCPU() const { return worker_ ? worker_->GetNumCPU() - numBusyCPU_ : 0; }
+    int64_t GetBusyMemory() const { return busyMemory_; }
+    int64_t GetFreeMemory() const { return worker_ ? worker_->GetMemorySize() - busyMemory_ : 0; }
+
+    // predicted time, when all executing tasks complete
+    void ExtendDrainTime( int64_t time ) { drainTime_ = std::max( drainTime_, time ); }
+    int64_t GetDrainTime() const { return drainTime_; }
+
     void SetWorker( WorkerPtr &w ) { worker_ = w; }
     WorkerPtr &GetWorker() { return worker_; }
     const WorkerPtr &GetWorker() const { return worker_; }
 
 private:
     int numBusyCPU_;
+    int64_t busyMemory_; // memory, reserved by executing tasks in MB
+    int64_t drainTime_; // steady clock time in ms
     WorkerPtr worker_;
 
+    // NodeIndex bucket list hook
+    NodeState *prevNode_, *nextNode_;
+    int indexBucket_; // -1, if the node isn't indexed
+
 };
 
 } // namespace master
@@ -26,6 +26,7 @@ the License.
 #include "common/log.h"
 #include "common/service_locator.h"
 #include "worker_manager.h"
+#include "scheduler.h"
 
 namespace master {
 
@@ -54,9 +55,30 @@ void Pinger::Run()
         timer_.Wait( pingDelay_ * 1000 );
         PingWorkers();
         CheckDropedPingResponses();
+        CheckStragglers();
+        CheckGangReservation();
+        CheckPreemption();
     }
 }
 
+void Pinger::CheckStragglers()
+{
+    auto scheduler = common::GetService< IScheduler >();
+    scheduler->CheckStragglers();
+}
+
+void Pinger::CheckGangReservation()
+{
+    auto scheduler = common::GetService< IScheduler >();
+    scheduler->CheckGangReservation();
+}
+
+void Pinger::CheckPreemption()
+{
+    auto scheduler = common::GetService< IScheduler >();
+    scheduler->CheckPreemption();
+}
+
 void Pinger::CheckDropedPingResponses()
 {
     if ( numPings_ < maxDroped_ + 1 )
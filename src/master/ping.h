@@ -58,6 +58,9 @@ protected:
     virtual void PingWorker( WorkerPtr &worker ) = 0;
 
     void CheckDropedPingResponses();
+    void CheckStragglers();
+    void CheckGangReservation();
+    void CheckPreemption();
 
     void OnWorkerIPResolve( WorkerPtr &worker, const std::string &ip );
 
@@ -0,0 +1,139 @@
+/*
+===========================================================================
+
+This software is licensed under the Apache 2 license, quoted below.
+
+Copyright (C) 2013 Andrey Budnik <budnik27@gmail.com>
+
+Licensed under the Apache License, Version 2.0 (the "License"); you may not
+use this file except in compliance with the License. You may obtain a copy of
+the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+License for the specific language governing permissions and limitations under
+the License.
+
+===========================================================================
+*/
+
+#ifndef __PLACEMENT_POLICY_H
+#define __PLACEMENT_POLICY_H
+
+#include <string>
+#include <vector>
+#include <random>
+#include "node_index.h"
+
+namespace master {
+
+enum class PlacementPolicy
+{
+    SPREAD,      // the most free node first
+    PACK,        // the least free node, which still has free CPU's, first
+    POWER_OF_TWO // the best of two randomly sampled nodes first
+};
+
+inline bool ParsePlacementPolicy( const std::string &name, PlacementPolicy &policy )
+{
+    if ( name == "spread" )
+        policy = PlacementPolicy::SPREAD;
+    else
+    if ( name == "pack" )
+        policy = PlacementPolicy::PACK;
+    else
+    if ( name == "power_of_two" )
+        policy = PlacementPolicy::POWER_OF_TWO;
+    else
+        return false;
+    return true;
+}
+
+// Node walkers. Nodes are taken from the free CPU index. Visitor is called for
+// nodes having free CPU's until it returns true. Visitor may move visited node
+// to another bucket of the index, so the next node is taken before visiting.
+
+template< typename Visitor >
+bool VisitNodesSpread( NodeIndex &nodes, Visitor &visitor )
+{
+    for( int bucket = nodes.GetMaxFreeCPU(); bucket > 0; )
+    {
+        bool restart = false;
+        for( NodeState *node = nodes.GetFirst( bucket ); node; )
+        {
+            NodeState *next = NodeIndex::GetNext( node );
+            const int numFreeCPU = node->GetNumFreeCPU();
+
+            if ( visitor( *node ) )
+                return true;
+
+            // node got a task, so the most free node may have changed
+            if ( node->GetNumFreeCPU() < numFreeCPU )
+            {
+                restart = true;
+                break;
+            }
+            node = next;
+        }
+        bucket = restart ? nodes.GetMaxFreeCPU() : nodes.GetPrevBucket( bucket );
+    }
+    return false;
+}
+
+template< typename Visitor >
+bool VisitNodesPack( NodeIndex &nodes, Visitor &visitor )
+{
+    for( int bucket = nodes.GetNextBucket( 0 ); bucket > 0; bucket = nodes.GetNextBucket( bucket ) )
+    {
+        for( NodeState *node = nodes.GetFirst( bucket ); node; )
+        {
+            NodeState &nodeState = *node;
+            node = NodeIndex::GetNext( node );
+
+            // fill up the node, before moving to the next one
+            int numFreeCPU = nodeState.GetNumFreeCPU();
+            while( numFreeCPU > 0 )
+            {
+                if ( visitor( nodeState ) )
+                    return true;
+
+                const int numLeft = nodeState.GetNumFreeCPU();
+                if ( numLeft >= numFreeCPU )
+                    break;
+                numFreeCPU = numLeft;
+            }
+        }
+    }
+    return false;
+}
+
+template< typename Compare, typename Visitor, typename Random >
+bool VisitNodesPowerOfTwo( NodeIndex &nodes, const std::vector< NodeState * > &candidates,
+                           Random &random, Visitor &visitor )
+{
+    if ( !candidates.empty() )
+    {
+        std::uniform_int_distribution< size_t > distribution( 0, candidates.size() - 1 );
+        NodeState *a = candidates[ distribution( random ) ];
+        NodeState *b = candidates[ distribution( random ) ];
+
+        Compare compare;
+        if ( compare( a, b ) )
+            std::swap( a, b );
+
+        if ( a->GetNumFreeCPU() > 0 && visitor( *a ) )
+            return true;
+        if ( b != a && b->GetNumFreeCPU() > 0 && visitor( *b ) )
+            return true;
+    }
+
+    // samples don't fit, so fall back to the whole walk
+    return VisitNodesSpread( nodes, visitor );
+}
+
+} // namespace master
+
+#endif
@@ -0,0 +1,156 @@
+/*
+===========================================================================
+
+This software is licensed under the Apache 2 license, quoted below.
+
+Copyright (C) 2013 Andrey Budnik <budnik27@gmail.com>
+
+Licensed under the Apache License, Version 2.0 (the "License"); you may not
+use this file except in compliance with the License. You may obtain a copy of
+the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+License for the specific language governing permissions and limitations under
+the License.
+
+===========================================================================
+*/
+
+#ifndef __PRIORITY_BUCKETS_H
+#define __PRIORITY_BUCKETS_H
+
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <stdint.h> // int64_t
+
+namespace master {
+
+// Priority queue for small integer priorities: a FIFO bucket per priority level
+// and a bitmap of non-empty levels. Push, pop, top and erase by id are O(1) for
+// priorities in [0, NUM_LEVELS); rare priorities out of the range are kept in
+// an ordered overflow map. The lower the priority value, the earlier it's served.
+template< typename T >
+class PriorityBuckets
+{
+    typedef std::list< std::pair< int64_t, T > > Bucket; // FIFO of (id, value)
+
+    struct Position
+    {
+        int priority_;
+        typename Bucket::iterator it_;
+    };
+
+    typedef std::map< int, Bucket > OverflowBuckets; // priority -> bucket
+    typedef std::unordered_map< int64_t, Position > IdToPosition;
+
+public:
+    static const int NUM_LEVELS = 64;
+
+public:
+    PriorityBuckets() : nonEmpty_( 0 ) {}
+
+    bool Push( int64_t id, int priority, const T &value )
+    {
+        if ( pos_.find( id ) != pos_.end() )
+            return false;
+
+        Bucket &bucket = GetBucket( priority );
+        bucket.emplace_back( id, value );
+        if ( IsLevel( priority ) )
+            nonEmpty_ |= uint64_t( 1 ) << priority;
+
+        Position &pos = pos_[ id ];
+        pos.priority_ = priority;
+        pos.it_ = --bucket.end();
+        return true;
+    }
+
+    bool Erase( int64_t id )
+    {
+        auto it = pos_.find( id );
+        if ( it == pos_.end() )
+            return false;
+
+        const int priority = it->second.priority_;
+        Bucket &bucket = GetBucket( priority );
+        bucket.erase( it->second.it_ );
+        pos_.erase( it );
+
+        if ( bucket.empty() )
+        {
+            if ( IsLevel( priority ) )
+                nonEmpty_ &= ~( uint64_t( 1 ) << priority );
+            else
+                overflow_.erase( priority );
+        }
+        return true;
+    }
+
+    const T *Find( int64_t id ) const
+    {
+        auto it = pos_.find( id );
+        return it != pos_.end() ? &it->second.it_->second : nullptr;
+    }
+
+    const T &Top() const { return TopBucket().front().second; }
+
+    void Pop() { Erase( TopBucket().front().first ); }
+
+    bool Empty() const { return pos_.empty(); }
+    size_t Size() const { return pos_.size(); }
+
+    // visits values in the priority order
+    template< typename F >
+    void ForEach( F f ) const
+    {
+        auto it = overflow_.begin();
+        for( ; it != overflow_.end() && it->first < 0; ++it )
+            VisitBucket( it->second, f );
+
+        for( uint64_t levels = nonEmpty_; levels; levels &= levels - 1 )
+            VisitBucket( buckets_[ __builtin_ctzll( levels ) ], f );
+
+        for( ; it != overflow_.end(); ++it )
+            VisitBucket( it->second, f );
+    }
+
+private:
+    static bool IsLevel( int priority ) { return priority >= 0 && priority < NUM_LEVELS; }
+
+    Bucket &GetBucket( int priority )
+    {
+        return IsLevel( priority ) ? buckets_[ priority ] : overflow_[ priority ];
+    }
+
+    const Bucket &TopBucket() const
+    {
+        if ( !overflow_.empty() && overflow_.begin()->first < 0 )
+            return overflow_.begin()->second;
+        if ( nonEmpty_ )
+            return buckets_[ __builtin_ctzll( nonEmpty_ ) ];
+        return overflow_.begin()->second;
+    }
+
+    template< typename F >
+    static void VisitBucket( const Bucket &bucket, F &f )
+    {
+        for( const auto &entry : bucket )
+            f( entry.second );
+    }
+
+private:
+    Bucket buckets_[ NUM_LEVELS ];
+    uint64_t nonEmpty_; // bit i is set if buckets_[i] isn't empty
+    OverflowBuckets overflow_;
+    IdToPosition pos_;
+};
+
+} // namespace master
+
+#endif
@@ -79,8 +79,34 @@ void ResultGetter::OnGetTaskResult( bool success, int errCode, int64_t execTime,
 {
     if ( !success ) // retrieving of job result from message failed
         errCode = -1;
+
+    {
+        std::unique_lock< std::mutex > lock( completionsMut_ );
+        completions_.push_back( TaskCompletion{ errCode, execTime, workerTask, hostIP } );
+        // results, arriving while other thread drains the buffer,
+        // are passed to the scheduler by that thread in one batch
+        if ( draining_ )
+            return;
+        draining_ = true;
+    }
+
     IScheduler *scheduler = common::GetService< IScheduler >();
-    scheduler->OnTaskCompletion( errCode, execTime, workerTask, hostIP );
+    TaskCompletions completions;
+    while( true )
+    {
+        {
+            std::unique_lock< std::mutex > lock( completionsMut_ );
+            if ( completions_.empty() )
+            {
+                draining_ = false;
+                break;
+            }
+            completions.swap( completions_ );
+        }
+
+        scheduler->OnTaskCompletions( completions );
+        completions.clear();
+    }
 }
 
 void ResultGetterBoost::Start()
@@ -32,6 +32,7 @@ the License.
 #include "common/helper.h"
 #include "common/request.h"
 #include "worker.h"
+#include "scheduler.h"
 
 using boost::asio::ip::tcp;
 
@@ -41,7 +42,7 @@ class ResultGetter : common::IObserver
 {
 public:
     ResultGetter()
-    : stopped_( false ), newJobAvailable_( false )
+    : stopped_( false ), newJobAvailable_( false ), draining_( false )
     {}
 
     virtual void Start() = 0;
@@ -64,6 +65,10 @@ private:
     std::mutex awakeMut_;
     std::condition_variable awakeCond_;
     bool newJobAvailable_;
+
+    TaskCompletions completions_; // task results, waiting for the scheduler
+    std::mutex completionsMut_;
+    bool draining_;
 };
 
 class GetterBoost : public boost::enable_shared_from_this< GetterBoost >
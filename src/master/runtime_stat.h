@@ -0,0 +1,89 @@
+/*
+===========================================================================
+
+This software is licensed under the Apache 2 license, quoted below.
+
+Copyright (C) 2013 Andrey Budnik <budnik27@gmail.com>
+
+Licensed under the Apache License, Version 2.0 (the "License"); you may not
+use this file except in compliance with the License. You may obtain a copy of
+the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+License for the specific language governing permissions and limitations under
+the License.
+
+===========================================================================
+*/
+
+#ifndef __RUNTIME_STAT_H
+#define __RUNTIME_STAT_H
+
+#include <string>
+#include <map>
+#include <cmath>
+#include <stdint.h> // int64_t
+
+namespace master {
+
+// Learned task execution times per job name. Each job name keeps exponentially
+// weighted moving average of task execution time and of its absolute
+// deviation, so the prediction follows recent runs.
+class RuntimeStat
+{
+    struct Runtime
+    {
+        Runtime() : mean_( 0. ), deviation_( 0. ), numSamples_( 0 ) {}
+
+        double mean_, deviation_;
+        int numSamples_;
+    };
+
+    typedef std::map< std::string, Runtime > NameToRuntime;
+
+public:
+    static const int MIN_SAMPLES = 3; // less samples don't give any prediction
+
+public:
+    // execTime in milliseconds
+    void Add( const std::string &name, int64_t execTime )
+    {
+        const double alpha = 0.2;
+
+        Runtime &runtime = runtimes_[ name ];
+        if ( !runtime.numSamples_ )
+        {
+            runtime.mean_ = execTime;
+        }
+        else
+        {
+            const double diff = execTime - runtime.mean_;
+            runtime.mean_ += alpha * diff;
+            runtime.deviation_ += alpha * ( std::fabs( diff ) - runtime.deviation_ );
+        }
+        ++runtime.numSamples_;
+    }
+
+    // pessimistic prediction of the task execution time in milliseconds
+    bool Predict( const std::string &name, int64_t &execTime ) const
+    {
+        auto it = runtimes_.find( name );
+        if ( it == runtimes_.end() || it->second.numSamples_ < MIN_SAMPLES )
+            return false;
+
+        const Runtime &runtime = it->second;
+        execTime = static_cast< int64_t >( runtime.mean_ + 2. * runtime.deviation_ );
+        return true;
+    }
+
+private:
+    NameToRuntime runtimes_;
+};
+
+} // namespace master
+
+#endif
@@ -25,9 +25,10 @@ the License.
 
 #include <set>
 #include <map>
-#include <boost/bimap/bimap.hpp>
-#include <boost/bimap/multiset_of.hpp>
+#include <vector>
 #include "job.h"
+#include "priority_buckets.h"
+#include "completion_executor.h"
 #include "cron_manager.h"
 #include "job_manager.h"
 #include "common/service_locator.h"
@@ -38,27 +39,15 @@ namespace master {
 class JobState
 {
 public:
-    JobState( JobPtr &job ) : job_( job ), sendedCompletely_( false ) {}
-    JobState() : sendedCompletely_( false ) {}
+    JobState( JobPtr &job ) : job_( job ) {}
+    JobState() {}
 
     const JobPtr &GetJob() const { return job_; }
 
-    bool IsSendedCompletely() const { return sendedCompletely_; }
-    void SetSendedCompletely( bool v ) { sendedCompletely_ = v; }
-
-    bool operator < ( const JobState &jobState ) const
-    {
-        static JobComparatorPriority comparator;
-        return comparator( jobState.GetJob(), job_ );
-    }
-
 private:
     JobPtr job_;
-    bool sendedCompletely_;
 };
 
-using namespace boost::bimaps;
-
 class ScheduledJobs
 {
 private:
@@ -66,10 +55,11 @@ private:
     typedef std::multimap< std::string, int64_t > JobNameToJob;
 
 public:
-    typedef bimap< set_of< int64_t >, multiset_of< JobState > > JobPriorityQueue; // job_id -> JobState
-    typedef JobPriorityQueue::right_map::const_iterator JobIterator;
+    typedef PriorityBuckets< JobState > JobPriorityQueue; // job_id -> JobState, FIFO per priority
 
 public:
+    ScheduledJobs() : executor_( nullptr ) {}
+
     void Add( JobPtr &job, int numExec )
     {
         jobExecutions_[ job->GetJobId() ] = numExec;
@@ -87,8 +77,7 @@ public:
             }
         }
 
-        typedef JobPriorityQueue::value_type value_type;
-        jobs_.insert( value_type( job->GetJobId(), JobState( job ) ) );
+        jobs_.Push( job->GetJobId(), job->GetPriority(), JobState( job ) );
     }
 
     void DecrementJobExecution( int64_t jobId, int numTasks, bool success )
@@ -107,11 +96,10 @@ public:
 
     bool FindJobByJobId( int64_t jobId, JobPtr &job ) const
     {
-        auto it = jobs_.left.find( jobId );
-        if ( it != jobs_.left.end() )
+        const JobState *jobState = jobs_.Find( jobId );
+        if ( jobState )
         {
-            const JobState &jobState = it->second;
-            job = jobState.GetJob();
+            job = jobState->GetJob();
             return true;
         }
 
@@ -120,13 +108,12 @@ public:
 
     void GetJobGroup( int64_t groupId, std::list< JobPtr > &jobs ) const
     {
-        for( auto it = jobs_.left.begin(); it != jobs_.left.end(); ++it )
+        jobs_.ForEach( [&]( const JobState &jobState )
         {
-            const JobState &jobState = it->second;
             const JobPtr &job = jobState.GetJob();
             if ( job->GetGroupId() == groupId )
                 jobs.push_back( job );
-        }
+        } );
     }
 
     void GetJobsByName( const std::string &name, std::set< int64_t > &jobs )
@@ -150,10 +137,11 @@ public:
         return -1;
     }
 
-    size_t GetNumJobs() const { return jobs_.left.size(); }
+    size_t GetNumJobs() const { return jobs_.Size(); }
 
-    JobIterator GetJobQueueBegin() const { return jobs_.right.begin(); }
-    JobIterator GetJobQueueEnd() const { return jobs_.right.end(); }
+    // visits jobs in the priority order
+    template< typename F >
+    void ForEachJob( F f ) const { jobs_.ForEach( f ); }
 
     template< typename T >
     void SetOnRemoveCallback( T *obj, void (T::*f)( int64_t jobId, bool success ) )
@@ -161,6 +149,21 @@ public:
         onRemoveCallback_ = std::bind( f, obj, std::placeholders::_1, std::placeholders::_2 );
     }
 
+    void SetCompletionExecutor( ICompletionExecutor *executor ) { executor_ = executor; }
+
+    // runs effect outside of the caller's critical section, if completion executor is set
+    void PostEffect( const ICompletionExecutor::Effect &effect )
+    {
+        if ( executor_ )
+        {
+            executor_->Post( effect );
+        }
+        else
+        {
+            effect();
+        }
+    }
+
     void RemoveJob( int64_t jobId, bool success, const char *completionStatus )
     {
         jobExecutions_.erase( jobId );
@@ -168,14 +171,18 @@ public:
         if ( onRemoveCallback_ )
             onRemoveCallback_( jobId, success );
 
-        auto it = jobs_.left.find( jobId );
-        if ( it != jobs_.left.end() )
+        const JobState *jobState = jobs_.Find( jobId );
+        if ( jobState )
         {
-            const JobState &jobState = it->second;
-            const JobPtr &job = jobState.GetJob();
-            RunJobCallback( job, completionStatus );
-            ReleaseJob( job, success );
-            jobs_.left.erase( it );
+            const JobPtr job( jobState->GetJob() );
+            ReleaseJobNames( job );
+            const std::string status( completionStatus );
+            PostEffect( [job, status, success]()
+            {
+                RunJobCallback( job, status );
+                ReleaseJob( job, success );
+            } );
+            jobs_.Erase( jobId );
         }
         else
         {
@@ -186,11 +193,10 @@ public:
     void Clear()
     {
         std::vector< int64_t > jobs;
-        for( auto it = jobs_.left.begin(); it != jobs_.left.end(); ++it )
+        jobs_.ForEach( [&jobs]( const JobState &jobState )
         {
-            const int64_t jobId = it->first;
-            jobs.push_back( jobId );
-        }
+            jobs.push_back( jobState.GetJob()->GetJobId() );
+        } );
 
         for( int64_t jobId : jobs )
         {
@@ -199,7 +205,7 @@ public:
     }
 
 private:
-    void RunJobCallback( const JobPtr &job, const char *completionStatus )
+    static void RunJobCallback( const JobPtr &job, const std::string &completionStatus )
     {
         std::ostringstream ss;
         ss << "Job completed, jobId=" << job->GetJobId() <<
@@ -214,7 +220,7 @@ private:
         job->RunCallback( "on_job_completion", params );
     }
 
-    void ReleaseJob( const JobPtr &job, bool success )
+    void ReleaseJobNames( const JobPtr &job )
     {
         if ( !job->GetName().empty() )
         {
@@ -225,7 +231,13 @@ private:
         {
             const std::string &metaJobName = job->GetJobGroup()->GetName();
             ReleaseMetaJobName( metaJobName, job->GetJobId() );
+        }
+    }
 
+    static void ReleaseJob( const JobPtr &job, bool success )
+    {
+        if ( job->GetJobGroup() )
+        {
             const bool lastJobInGroup = job->ReleaseJobGroup();
             if ( lastJobInGroup )
             {
@@ -276,23 +288,26 @@ private:
     IdToJobExec jobExecutions_; // job_id -> num job remaining executions (== 0, if job execution completed)
     JobNameToJob nameToJob_;
     std::function< void (int64_t, bool) > onRemoveCallback_;
+    ICompletionExecutor *executor_;
 };
 
 
 class JobExecHistory
 {
-    typedef std::map< std::string, int > IPToNumExec;
+    typedef std::vector< int > HostIdToNumExec;
     struct JobHistory
     {
-        IPToNumExec numExec_;
+        HostIdToNumExec numExec_;
     };
 
     typedef std::map< int64_t, JobHistory > JobIdToHistory;
 public:
-    void IncrementNumExec( int64_t jobId, const std::string &hostIP )
+    void IncrementNumExec( int64_t jobId, uint32_t hostId )
     {
-        JobHistory &jobHistory = history_[ jobId ];
-        ++jobHistory.numExec_[ hostIP ];
+        HostIdToNumExec &numExec = history_[ jobId ].numExec_;
+        if ( hostId >= numExec.size() )
+            numExec.resize( hostId + 1 );
+        ++numExec[ hostId ];
     }
 
     void RemoveJob( int jobId )
@@ -300,16 +315,15 @@ public:
         history_.erase( jobId );
     }
 
-    int GetNumExec( int64_t jobId, const std::string &hostIP ) const
+    int GetNumExec( int64_t jobId, uint32_t hostId ) const
     {
         const auto it = history_.find( jobId );
         if ( it != history_.end() )
         {
             const JobHistory &jobHistory = it->second;
-            const IPToNumExec &numExec = jobHistory.numExec_;
-            const auto e_it = numExec.find( hostIP );
-            if ( e_it != numExec.end() )
-                return e_it->second;
+            const HostIdToNumExec &numExec = jobHistory.numExec_;
+            if ( hostId < numExec.size() )
+                return numExec[ hostId ];
         }
         return 0;
     }
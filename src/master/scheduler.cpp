@@ -20,7 +20,11 @@ the License.
 ===========================================================================
 */
 
+#include <algorithm>
+#include <chrono>
+#include <limits>
 #include "scheduler.h"
+#include "fair_share.h"
 #include "common/log.h"
 #include "common/error_code.h"
 #include "common/service_locator.h"
@@ -34,7 +38,20 @@ the License.
 
 namespace master {
 
+namespace {
+
+int64_t GetTimeMillis()
+{
+    using namespace std::chrono;
+    return duration_cast< milliseconds >( steady_clock::now().time_since_epoch() ).count();
+}
+
+} // anonymous namespace
+
 Scheduler::Scheduler()
+: nextShard_( 0 ), placementPolicy_( PlacementPolicy::SPREAD ), backfill_( false ), speculation_( false ),
+ gangTimeout_( 60 ), preemptionBudget_( 0 ), numPreempted_( 0 ), preemptionWindow_( 0 ),
+ localityDelay_( 0 ), planningWindow_( 1 ), numJobsExamined_( 0 )
 {
     jobs_.SetOnRemoveCallback( this, &Scheduler::OnRemoveJob );
 }
@@ -43,9 +60,14 @@ void Scheduler::OnHostAppearance( WorkerPtr &worker )
 {
     {
         std::unique_lock< std::mutex > lock( workersMut_ );
-        nodeState_[ worker->GetIP() ].SetWorker( worker );
-        typedef NodePriorityQueue::value_type value_type;
-        nodePriority_.insert( value_type( worker->GetIP(), &nodeState_[ worker->GetIP() ] ) );
+        NodeShard &shard = shards_[ worker->GetGroup() ];
+        const bool newNode = nodeState_.find( worker->GetIP() ) == nodeState_.end();
+        NodeState &nodeState = nodeState_[ worker->GetIP() ];
+        if ( newNode )
+            shard.nodeList_.push_back( &nodeState );
+        nodeState.SetWorker( worker );
+        UpdateCapacity();
+        shard.nodeIndex_.Update( &nodeState );
 
         auto workerManager = common::GetService< IWorkerManager >();
         CommandPtr commandPtr = std::make_shared< StopPreviousJobsCommand >();
@@ -74,14 +96,30 @@ void Scheduler::DeleteWorker( const std::string &host )
 
             StopWorker( worker->GetIP() );
 
-            failedWorkers_.Add( workerJob, worker->GetIP() );
+            failedWorkers_.Add( workerJob, worker->GetHostId() );
+            ReleaseGangNode( worker->GetIP() );
 
-            nodePriority_.left.erase( worker->GetIP() );
+            auto it_shard = shards_.find( worker->GetGroup() );
+            if ( it_shard != shards_.end() )
+            {
+                NodeShard &shard = it_shard->second;
+                shard.nodeIndex_.Erase( &it->second );
+                auto it_list = std::find( shard.nodeList_.begin(), shard.nodeList_.end(), &it->second );
+                if ( it_list != shard.nodeList_.end() )
+                {
+                    *it_list = shard.nodeList_.back();
+                    shard.nodeList_.pop_back();
+                }
+                if ( shard.nodeList_.empty() )
+                    shards_.erase( it_shard );
+            }
             nodeState_.erase( it++ );
 
             // worker job should be rescheduled to any other node
+            std::unique_lock< std::mutex > lock_j( jobsMut_ );
             RescheduleJob( workerJob );
         }
+        UpdateCapacity();
     }
     NotifyAll();
 }
@@ -108,12 +146,18 @@ void Scheduler::OnChangedWorkerState( std::vector< WorkerPtr > &workers )
                 PLOG( "Scheduler::OnChangedWorkerState: worker node is lost: nodeIP=" << worker->GetIP() <<
                       ", numExecutingTasks=" << workerJob.GetTotalNumTasks() );
 
-                failedWorkers_.Add( workerJob, worker->GetIP() );
+                failedWorkers_.Add( workerJob, worker->GetHostId() );
                 nodeState.Reset();
                 worker->ResetJob();
-                UpdateNodePriority( worker->GetIP(), &nodeState );
+                ReleaseGangNode( worker->GetIP() );
+                UpdateNodePriority( worker->GetHostId(), &nodeState );
 
-                if ( RescheduleJob( workerJob ) )
+                bool found;
+                {
+                    std::unique_lock< std::mutex > lock_j( jobsMut_ );
+                    found = RescheduleJob( workerJob );
+                }
+                if ( found )
                 {
                     lock.unlock();
                     NotifyAll();
@@ -132,30 +176,99 @@ void Scheduler::OnChangedWorkerState( std::vector< WorkerPtr > &workers )
 void Scheduler::OnNewJob()
 {
     if ( CanTakeNewJob() )
+    {
         PlanJobExecution();
+    }
+    else
+    if ( preemptionBudget_ > 0 )
+    {
+        // full cluster may free CPU's for the more prioritized job,
+        // so take it from the job queue, unless some job already waits
+        bool waiting;
+        {
+            std::unique_lock< std::mutex > lock( jobsMut_ );
+            waiting = !tasksToSend_.empty();
+        }
+        if ( !waiting )
+            PlanJobExecution();
+
+        if ( PreemptTasks() )
+            NotifyAll();
+    }
 }
 
-void Scheduler::UpdateNodePriority( const std::string &ip, NodeState *nodeState )
+void Scheduler::UpdateNodePriority( uint32_t hostId, NodeState *nodeState )
 {
-    nodePriority_.left.erase( ip );
     if ( nodeState )
     {
-        typedef NodePriorityQueue::value_type value_type;
-        nodePriority_.insert( value_type( ip, nodeState ) );
+        NodeIndex &nodeIndex = shards_[ nodeState->GetWorker()->GetGroup() ].nodeIndex_;
+        nodeIndex.Update( nodeState );
     }
     else
     {
-        PLOG_ERR( "Scheduler::UpdateNodePriority: nodeState is null, hostIP=" << ip );
+        PLOG_ERR( "Scheduler::UpdateNodePriority: nodeState is null, hostId=" << hostId );
     }
 }
 
+void Scheduler::UpdateCapacity() const
+{
+    int numCPU = 0;
+    int64_t memory = 0;
+    for( const auto &it : nodeState_ )
+    {
+        const WorkerPtr &worker = it.second.GetWorker();
+        numCPU += worker->GetNumCPU();
+        memory += worker->GetMemorySize();
+    }
+    FairShare::Instance().SetCapacity( numCPU, memory );
+}
+
 void Scheduler::PlanJobExecution()
+{
+    // lookahead: take jobs from the queue, until their
+    // tasks cover all free CPU's of the cluster
+    int numFreeCPU = 0;
+    size_t numPending = 0;
+    if ( planningWindow_ > 1 )
+    {
+        std::unique_lock< std::mutex > lock_w( workersMut_ );
+        std::unique_lock< std::mutex > lock_j( jobsMut_ );
+
+        for( const auto &it : nodeState_ )
+        {
+            numFreeCPU += std::max( it.second.GetNumFreeCPU(), 0 );
+        }
+        for( const auto &it : tasksToSend_ )
+        {
+            numPending += it.second.size();
+        }
+    }
+
+    int numPlanned = 0;
+    while( numPlanned < planningWindow_ )
+    {
+        if ( numPlanned > 0 && numPending >= static_cast< size_t >( numFreeCPU ) )
+            break;
+
+        const int numExec = PlanNextJob();
+        if ( !numExec )
+            break;
+
+        numPending += numExec;
+        ++numPlanned;
+    }
+
+    if ( numPlanned )
+        NotifyAll();
+}
+
+int Scheduler::PlanNextJob()
 {
     JobPtr job;
 
     auto jobManager = common::GetService< IJobManager >();
     if ( !jobManager->PopJob( job ) )
-        return;
+        return 0;
 
     const int numExec = GetNumPlannedExec( job );
     job->SetNumPlannedExec( numExec );
@@ -164,18 +277,21 @@ void Scheduler::PlanJobExecution()
     {
         std::unique_lock< std::mutex > lock( jobsMut_ );
 
-        std::set< int > &tasks = tasksToSend_[ jobId ];
-        for( int taskId = 0; taskId < numExec; ++taskId )
-        {
-            tasks.insert( taskId );
-        }
+        tasksToSend_[ jobId ].insert( 0, numExec - 1 );
 
         jobs_.Add( job, numExec );
-    }
+        // tasks of a gang job are placed all at once, not one by one
+        if ( job->IsGang() )
+            gangJobs_.insert( job );
+        else
+            eligibleJobs_.Add( job );
 
-    PLOG_DBG( "Scheduler::PlanJobExecution: JobId=" << jobId << ", numExec=" << numExec );
+        if ( localityDelay_ > 0 )
+            localityWait_[ jobId ] = GetTimeMillis();
+    }
 
-    NotifyAll();
+    PLOG_DBG( "Scheduler::PlanNextJob: JobId=" << jobId << ", numExec=" << numExec );
+    return numExec;
 }
 
 bool Scheduler::RescheduleJob( const WorkerJob &workerJob )
@@ -184,8 +300,6 @@ bool Scheduler::RescheduleJob( const WorkerJob &workerJob )
     std::set<int64_t> jobs;
     workerJob.GetJobs( jobs );
 
-    std::unique_lock< std::mutex > lock( jobsMut_ );
-
     for( auto jobId : jobs )
     {
         JobPtr job;
@@ -193,6 +307,36 @@ bool Scheduler::RescheduleJob( const WorkerJob &workerJob )
         {
             simultExecCnt_[ jobId ] -= workerJob.GetNumTasks( jobId );
 
+            // gang job can't run without any of its tasks
+            if ( job->IsGang() )
+            {
+                StopWorkers( jobId );
+                jobs_.RemoveJob( jobId, false, "gang task failed" );
+                continue;
+            }
+
+            WorkerJob::Tasks tasks;
+            workerJob.GetTasks( jobId, tasks );
+
+            if ( speculation_ )
+            {
+                // tasks, which still execute elsewhere as speculative copies, need no reschedule
+                std::vector< int > copies;
+                for( auto taskId : tasks )
+                {
+                    if ( stragglers_.IsSpeculated( jobId, taskId ) && HasTaskCopy( jobId, taskId ) )
+                        copies.push_back( taskId );
+                    else
+                        stragglers_.OnTaskStop( jobId, taskId );
+                }
+                for( auto taskId : copies )
+                {
+                    tasks.erase( taskId );
+                }
+                if ( tasks.empty() )
+                    continue;
+            }
+
             if ( job->GetMaxFailedNodes() >= 0 )
             {
                 const size_t failedNodesCnt = failedWorkers_.GetFailedNodesCnt( jobId );
@@ -206,18 +350,23 @@ bool Scheduler::RescheduleJob( const WorkerJob &workerJob )
 
             if ( job->IsNoReschedule() )
             {
-                jobs_.DecrementJobExecution( jobId, workerJob.GetNumTasks( jobId ), false );
+                jobs_.DecrementJobExecution( jobId, tasks.size(), false );
                 continue;
             }
 
-            WorkerJob::Tasks tasks;
-            workerJob.GetTasks( jobId, tasks );
+            if ( tasks.empty() )
+                continue;
+
+            common::IntervalSet &reschedTasks = needReschedule_[ jobId ];
+            if ( reschedTasks.empty() )
+                reschedJobs_.Add( job );
+
             for( auto taskId : tasks )
             {
                 PLOG_DBG( "Scheduler::RescheduleJob: jobId=" << jobId << ", taskId=" << taskId );
-                needReschedule_.emplace_back( jobId, taskId );
-                found = true;
+                reschedTasks.insert( taskId );
             }
+            found = true;
         }
         else
         {
@@ -227,161 +376,503 @@ bool Scheduler::RescheduleJob( const WorkerJob &workerJob )
     return found;
 }
 
-bool Scheduler::GetReschedJobForWorker( const WorkerPtr &worker, WorkerJob &plannedJob, JobPtr &job, int numFreeCPU )
+bool Scheduler::FindJobForWorker( const EligibleJobs &index, const NodeState &nodeState,
+                                  const WorkerJob &plannedJob, JobPtr &job ) const
 {
-    int64_t jobId;
-    bool foundReschedJob = false;
+    const WorkerPtr &worker = nodeState.GetWorker();
+    const uint32_t hostId = worker->GetHostId();
+
+    // if an exclusive job waits for the node to drain, then the node is
+    // reserved for it, and lower priority jobs may only backfill the node
+    // with tasks, which are predicted to complete before the node drains
+    const int64_t now = ( backfill_ || localityDelay_ > 0 ) ? GetTimeMillis() : 0;
+    int64_t reservedUntil = -1;
 
-    for( auto it = needReschedule_.begin(); it != needReschedule_.end(); )
+    auto visitor = [&]( const JobPtr &candidate ) -> bool
     {
-        if ( plannedJob.GetTotalNumTasks() >= numFreeCPU )
-            break;
+        const int64_t jobId = candidate->GetJobId();
+        ++numJobsExamined_;
 
-        const WorkerTask &workerTask = *it;
+        if ( failedWorkers_.IsWorkerFailedJob( hostId, jobId ) )
+            return false;
+
+        if ( !candidate->IsHostPermitted( worker->GetHost() ) ||
+             !candidate->IsGroupPermitted( worker->GetGroup() ) )
+            return false;
 
-        if ( !jobs_.FindJobByJobId( workerTask.GetJobId(), job ) ||
-             !CanAddTaskToWorker( worker, plannedJob, workerTask.GetJobId(), job ) )
+        if ( localityDelay_ > 0 && !IsLocalityPermitted( candidate, hostId, now ) )
+            return false;
+
+        if ( reservedUntil >= 0 )
         {
-            ++it;
-            continue;
+            int64_t execTime;
+            if ( !PredictTaskRuntime( candidate, execTime ) || now + execTime > reservedUntil )
+                return false;
         }
 
-        if ( foundReschedJob )
+        if ( !CanAddTaskToWorker( nodeState, plannedJob, jobId, candidate ) )
         {
-            if ( workerTask.GetJobId() == jobId )
+            const WorkerJob &workerJob = worker->GetJob();
+            const bool waitsForDrain = candidate->IsExclusive() &&
+                ( workerJob.GetNumJobs() > 1 || ( workerJob.GetNumJobs() == 1 && !workerJob.HasJob( jobId ) ) );
+
+            if ( backfill_ && reservedUntil < 0 && waitsForDrain )
             {
-                plannedJob.AddTask( jobId, workerTask.GetTaskId() );
-                needReschedule_.erase( it++ );
-                continue;
+                // unpredictable drain time doesn't let to backfill any task
+                const int64_t drainTime = nodeState.GetDrainTime();
+                reservedUntil = ( drainTime == std::numeric_limits< int64_t >::max() ) ? now : drainTime;
             }
+            return false;
         }
-        else
+
+        job = candidate;
+        return true;
+    };
+
+    if ( !FairShare::Instance().IsEnabled() )
+        return index.Visit( worker, visitor );
+
+    // fair share case: take the most prioritized job of the least served queue
+    const FairShare &fairShare = FairShare::Instance();
+    JobPtr top;
+    double topShare = 0.;
+    std::set< std::string > queues;
+
+    auto fairVisitor = [&]( const JobPtr &candidate ) -> bool
+    {
+        if ( queues.find( candidate->GetQueue() ) != queues.end() )
+            return false;
+
+        if ( !visitor( candidate ) )
+            return false;
+
+        queues.insert( candidate->GetQueue() );
+        const double share = fairShare.GetShare( candidate->GetQueue() );
+        if ( !top || share < topShare )
         {
-            jobId = workerTask.GetJobId();
-            if ( !failedWorkers_.IsWorkerFailedJob( worker->GetIP(), jobId ) )
-            {
-                if ( job->IsHostPermitted( worker->GetHost() ) &&
-                     job->IsGroupPermitted( worker->GetGroup() ) )
-                {
-                    foundReschedJob = true;
-                    plannedJob.AddTask( jobId, workerTask.GetTaskId() );
-                    plannedJob.SetExclusive( job->IsExclusive() );
-                    history_.IncrementNumExec( jobId, worker->GetIP() );
-                    needReschedule_.erase( it++ );
-                    continue;
-                }
-            }
+            top = candidate;
+            topShare = share;
         }
-        ++it;
+        return false;
+    };
+
+    index.Visit( worker, fairVisitor );
+    job = top;
+    return static_cast< bool >( top );
+}
+
+bool Scheduler::GetReschedJobForWorker( const NodeState &nodeState, WorkerJob &plannedJob, JobPtr &job )
+{
+    if ( !FindJobForWorker( reschedJobs_, nodeState, plannedJob, job ) )
+        return false;
+
+    PlanJobTasks( needReschedule_, reschedJobs_, nodeState, plannedJob, job );
+    return plannedJob.GetTotalNumTasks() > 0;
+}
+
+bool Scheduler::GetJobForWorker( const NodeState &nodeState, WorkerJob &plannedJob, JobPtr &job )
+{
+    if ( GetReschedJobForWorker( nodeState, plannedJob, job ) )
+    {
+        // plannedJob tasks must belong to the only one job,
+        // so try to add not yet sended tasks of the same job
+        PlanJobTasks( tasksToSend_, eligibleJobs_, nodeState, plannedJob, job );
+        return true;
     }
 
-    return foundReschedJob;
+    if ( FindJobForWorker( eligibleJobs_, nodeState, plannedJob, job ) )
+    {
+        PlanJobTasks( tasksToSend_, eligibleJobs_, nodeState, plannedJob, job );
+    }
+
+    if ( plannedJob.GetTotalNumTasks() > 0 )
+        return true;
+
+    // idle worker may execute copies of the straggler tasks
+    return speculation_ && PlanSpeculativeTasks( nodeState, plannedJob, job );
 }
 
-bool Scheduler::GetJobForWorker( const WorkerPtr &worker, WorkerJob &plannedJob, JobPtr &job, int numFreeCPU )
+void Scheduler::PlanJobTasks( JobIdToTasks &pending, EligibleJobs &index,
+                              const NodeState &nodeState, WorkerJob &plannedJob, const JobPtr &job )
 {
-    bool foundReschedJob = GetReschedJobForWorker( worker, plannedJob, job, numFreeCPU );
-    int64_t jobId = plannedJob.GetJobId();
+    const int64_t jobId = job->GetJobId();
+    const int numFreeCPU = nodeState.GetNumFreeCPU();
+
+    auto it = pending.find( jobId );
+    if ( it == pending.end() )
+        return;
 
-    for( auto j_it = jobs_.GetJobQueueBegin(); j_it != jobs_.GetJobQueueEnd(); ++j_it )
+    common::IntervalSet &tasks = it->second;
+    while( !tasks.empty() )
     {
-        JobState &jobState = const_cast< JobState & >(j_it->first);
-        if ( jobState.IsSendedCompletely() )
-            continue;
+        if ( plannedJob.GetTotalNumTasks() >= numFreeCPU ||
+             !CanAddTaskToWorker( nodeState, plannedJob, jobId, job ) )
+            break;
 
-        const JobPtr &j = jobState.GetJob();
+        const int taskId = *tasks.begin();
+        plannedJob.AddTask( jobId, taskId );
+        plannedJob.SetExclusive( job->IsExclusive() );
+        // exec history is consulted only for jobs having max_exec_at_worker limit
+        if ( job->GetMaxExecAtWorker() > 0 )
+            history_.IncrementNumExec( jobId, nodeState.GetWorker()->GetHostId() );
 
-        // plannedJob tasks must belong to the only one job,
-        // so jobId must be the same
-        if ( foundReschedJob && jobId != j->GetJobId() )
-            continue;
+        tasks.erase( taskId );
+    }
+
+    if ( tasks.empty() )
+    {
+        pending.erase( it );
+        index.Remove( job );
+    }
+}
+
+void Scheduler::ErasePendingTasks( JobIdToTasks &pending, EligibleJobs &index, int64_t jobId )
+{
+    if ( pending.erase( jobId ) )
+    {
+        JobPtr job;
+        if ( jobs_.FindJobByJobId( jobId, job ) )
+            index.Remove( job );
+    }
+}
+
+bool Scheduler::PlanSpeculativeTasks( const NodeState &nodeState, WorkerJob &plannedJob, JobPtr &job )
+{
+    if ( !FindJobForWorker( specJobs_, nodeState, plannedJob, job ) )
+        return false;
+
+    const int64_t jobId = job->GetJobId();
+    auto it = speculative_.find( jobId );
+    if ( it == speculative_.end() )
+        return false;
+
+    const WorkerJob &workerJob = nodeState.GetWorker()->GetJob();
+    const int numFreeCPU = nodeState.GetNumFreeCPU();
+
+    common::IntervalSet &tasks = it->second;
+    std::vector< int > planned;
+    for( auto taskId : tasks )
+    {
+        if ( plannedJob.GetTotalNumTasks() >= numFreeCPU ||
+             !CanAddTaskToWorker( nodeState, plannedJob, jobId, job ) )
+            break;
 
-        if ( failedWorkers_.IsWorkerFailedJob( worker->GetIP(), j->GetJobId() ) )
+        // copy must execute on the other worker
+        if ( workerJob.HasTask( jobId, taskId ) )
             continue;
 
-        if ( !CanAddTaskToWorker( worker, plannedJob, j->GetJobId(), j ) )
+        plannedJob.AddTask( jobId, taskId );
+        plannedJob.SetExclusive( job->IsExclusive() );
+        planned.push_back( taskId );
+    }
+
+    for( auto taskId : planned )
+    {
+        tasks.erase( taskId );
+    }
+
+    if ( tasks.empty() )
+    {
+        speculative_.erase( it );
+        specJobs_.Remove( job );
+    }
+
+    return plannedJob.GetTotalNumTasks() > 0;
+}
+
+bool Scheduler::HasTaskCopy( int64_t jobId, int taskId ) const
+{
+    auto it_hosts = jobHosts_.find( jobId );
+    if ( it_hosts == jobHosts_.end() )
+        return false;
+
+    for( const auto &hostIP : it_hosts->second )
+    {
+        auto it = nodeState_.find( hostIP );
+        if ( it == nodeState_.end() )
             continue;
 
-        auto it = tasksToSend_.find( j->GetJobId() );
-        if ( it == tasksToSend_.end() )
+        const WorkerJob &workerJob = it->second.GetWorker()->GetJob();
+        if ( workerJob.HasTask( jobId, taskId ) )
+            return true;
+    }
+    return false;
+}
+
+void Scheduler::StopTaskCopies( int64_t jobId, int taskId, int64_t taskMemory )
+{
+    auto it_spec = speculative_.find( jobId );
+    if ( it_spec != speculative_.end() )
+    {
+        it_spec->second.erase( taskId );
+        if ( it_spec->second.empty() )
+            ErasePendingTasks( speculative_, specJobs_, jobId );
+    }
+
+    auto it_hosts = jobHosts_.find( jobId );
+    if ( it_hosts == jobHosts_.end() )
+        return;
+
+    auto workerManager = common::GetService< IWorkerManager >();
+
+    std::set< std::string > &hosts = it_hosts->second;
+    for( auto it = hosts.begin(); it != hosts.end(); )
+    {
+        auto it_node = nodeState_.find( *it );
+        if ( it_node == nodeState_.end() )
+        {
+            ++it;
             continue;
+        }
+
+        NodeState &nodeState = it_node->second;
+        WorkerPtr &worker = nodeState.GetWorker();
+        WorkerJob &workerJob = worker->GetJob();
 
-        std::set< int > &tasks = it->second;
-        if ( !tasks.empty() )
+        if ( workerJob.DeleteTask( jobId, taskId ) )
         {
-            if ( !j->IsHostPermitted( worker->GetHost() ) ||
-                 !j->IsGroupPermitted( worker->GetGroup() ) )
-                continue;
+            PLOG( "Scheduler::StopTaskCopies: jobId=" << jobId << ", taskId=" << taskId <<
+                  ", ip=" << worker->GetIP() );
 
-            for( auto it_task = tasks.begin(); it_task != tasks.end(); )
-            {
-                if ( plannedJob.GetTotalNumTasks() >= numFreeCPU ||
-                     !CanAddTaskToWorker( worker, plannedJob, j->GetJobId(), j ) )
-                    break;
+            CommandPtr commandPtr = std::make_shared< StopTaskCommand >();
+            commandPtr->SetParam( "job_id", jobId );
+            commandPtr->SetParam( "task_id", taskId );
+            workerManager->AddCommand( commandPtr, worker->GetIP() );
+
+            nodeState.FreeCPU( 1 );
+            nodeState.FreeMemory( taskMemory );
+            UpdateNodePriority( worker->GetHostId(), &nodeState );
+            simultExecCnt_[ jobId ] -= 1;
+        }
 
-                int taskId = *it_task;
-                plannedJob.AddTask( j->GetJobId(), taskId );
-                plannedJob.SetExclusive( j->IsExclusive() );
-                history_.IncrementNumExec( jobId, worker->GetIP() );
+        if ( workerJob.HasJob( jobId ) )
+            ++it;
+        else
+            hosts.erase( it++ );
+    }
+}
 
-                tasks.erase( it_task++ );
-                if ( tasks.empty() )
-                {
-                    jobState.SetSendedCompletely( true );
-                    tasksToSend_.erase( it );
-                    break;
-                }
-            }
-            job = const_cast<JobPtr &>( j );
-            break;
+bool Scheduler::PlanTaskToSend( NodeState &nodeState, WorkerJob &workerJob, std::string &hostIP, JobPtr &job )
+{
+    const int numFreeCPU = nodeState.GetNumFreeCPU();
+
+    WorkerPtr &w = nodeState.GetWorker();
+    if ( !w->IsAvailable() )
+        return false;
+
+    if ( !GetJobForWorker( nodeState, workerJob, job ) )
+        return false;
+
+    hostIP = w->GetIP();
+    CommitTaskToSend( nodeState, workerJob, job );
+
+    PLOG_DBG( "Scheduler::PlanTaskToSend: jobId=" << workerJob.GetJobId() <<
+              ", numTasks=" << workerJob.GetTotalNumTasks() << ", host=" << w->GetHost() << ", ip=" << hostIP <<
+              ", freeCPU=" << numFreeCPU << ", totalCPU=" << w->GetNumCPU() <<
+              ", memory=" << w->GetMemorySize() << ", freeMemory=" << nodeState.GetFreeMemory() );
+    return true;
+}
+
+void Scheduler::CommitTaskToSend( NodeState &nodeState, const WorkerJob &workerJob, const JobPtr &job )
+{
+    WorkerPtr &w = nodeState.GetWorker();
+    w->GetJob() += workerJob;
+    jobHosts_[ workerJob.GetJobId() ].insert( w->GetIP() );
+
+    if ( localityDelay_ > 0 )
+    {
+        // local task launch restarts waiting for the local workers
+        const int64_t now = GetTimeMillis();
+        const std::string &key = GetLocalityKey( job );
+        if ( locality_.IsLocal( key, w->GetHostId() ) )
+        {
+            auto it = localityWait_.find( workerJob.GetJobId() );
+            if ( it != localityWait_.end() )
+                it->second = now;
         }
+        locality_.Add( key, w->GetHostId(), now );
     }
 
-    return plannedJob.GetTotalNumTasks() > 0;
+    const int numTasks = workerJob.GetTotalNumTasks();
+    nodeState.AllocCPU( numTasks );
+    nodeState.AllocMemory( numTasks * job->GetTaskMemory() );
+    UpdateNodePriority( w->GetHostId(), &nodeState );
+    simultExecCnt_[ workerJob.GetJobId() ] += numTasks;
+
+    if ( speculation_ )
+    {
+        const int64_t now = GetTimeMillis();
+        WorkerJob::Tasks tasks;
+        workerJob.GetTasks( workerJob.GetJobId(), tasks );
+        for( auto taskId : tasks )
+        {
+            stragglers_.OnTaskStart( workerJob.GetJobId(), job->GetNumPlannedExec(), taskId, now );
+        }
+    }
+
+    if ( backfill_ )
+    {
+        int64_t execTime;
+        nodeState.ExtendDrainTime( PredictTaskRuntime( job, execTime ) ?
+                                   GetTimeMillis() + execTime : std::numeric_limits< int64_t >::max() );
+    }
+}
+
+template< typename Visitor >
+bool Scheduler::VisitNodes( Visitor &visitor )
+{
+    if ( shards_.empty() )
+        return false;
+
+    // each walk starts from the next shard, so groups share the load
+    auto start = shards_.begin();
+    std::advance( start, nextShard_++ % shards_.size() );
+
+    auto it = start;
+    do
+    {
+        if ( IsShardEligible( it->first ) && VisitShard( it->second, visitor ) )
+            return true;
+
+        if ( ++it == shards_.end() )
+            it = shards_.begin();
+    }
+    while( it != start );
+
+    return false;
+}
+
+template< typename Visitor >
+bool Scheduler::VisitShard( NodeShard &shard, Visitor &visitor )
+{
+    NodeIndex &nodes = shard.nodeIndex_;
+    switch( placementPolicy_ )
+    {
+        case PlacementPolicy::PACK:
+            return VisitNodesPack( nodes, visitor );
+        case PlacementPolicy::POWER_OF_TWO:
+            return VisitNodesPowerOfTwo< CompareByCPUandMemory >( nodes, shard.nodeList_, random_, visitor );
+        default:
+            return VisitNodesSpread( nodes, visitor );
+    }
+}
+
+bool Scheduler::IsShardEligible( const std::string &group ) const
+{
+    // nodes of the group are walked only if some job may be placed there
+    return gang_.job_ || !gangJobs_.empty() ||
+        eligibleJobs_.HasJobs( group ) ||
+        reschedJobs_.HasJobs( group ) ||
+        specJobs_.HasJobs( group );
 }
 
 bool Scheduler::GetTaskToSend( WorkerJob &workerJob, std::string &hostIP, JobPtr &job )
 {
-    std::unique_lock< std::mutex > lock_w( workersMut_ );
+    const int64_t start = SchedulerStat::GetTimeMicros();
+    {
+        std::unique_lock< std::mutex > lock_w( workersMut_, std::defer_lock );
+        std::unique_lock< std::mutex > lock_j( jobsMut_, std::defer_lock );
+        LockTimed( lock_w, SchedulerStat::WORKERS_LOCK_WAIT );
+        LockTimed( lock_j, SchedulerStat::JOBS_LOCK_WAIT );
+
+        PlanGangJob();
+        if ( !readyTasks_.empty() )
+        {
+            const TaskToSend &task = readyTasks_.front();
+            workerJob = task.workerJob_;
+            hostIP = task.hostIP_;
+            job = task.job_;
+            readyTasks_.pop_front();
+            stat_.Add( SchedulerStat::GET_TASK_TIME, SchedulerStat::GetTimeMicros() - start );
+            return true;
+        }
 
-    auto it = nodePriority_.right.rbegin();
+        int numNodes = 0;
+        numJobsExamined_ = 0;
+        auto visitor = [&]( NodeState &nodeState ) -> bool
+        {
+            ++numNodes;
+            return PlanTaskToSend( nodeState, workerJob, hostIP, job );
+        };
+
+        const bool planned = VisitNodes( visitor );
+        stat_.Add( SchedulerStat::NODES_EXAMINED, numNodes );
+        stat_.Add( SchedulerStat::JOBS_EXAMINED, numJobsExamined_ );
+        stat_.Add( SchedulerStat::GET_TASK_TIME, SchedulerStat::GetTimeMicros() - start );
+        if ( planned )
+            return true;
+    }
 
-    std::unique_lock< std::mutex > lock_j( jobsMut_ );
+    // if there is any worker available, but all queued jobs are
+    // sended to workers, then take next job from job mgr queue
+    OnNewJob();
+
+    return false;
+}
 
-    for( ; it != nodePriority_.right.rend(); ++it )
+bool Scheduler::GetTasksToSend( TasksToSend &tasks, size_t maxTasks )
+{
+    const int64_t start = SchedulerStat::GetTimeMicros();
+    const size_t numTasks = tasks.size();
     {
-        NodeState &nodeState = *(it->first);
-        const int numFreeCPU = nodeState.GetNumFreeCPU();
-        if ( numFreeCPU <= 0 )
-            continue;
+        std::unique_lock< std::mutex > lock_w( workersMut_, std::defer_lock );
+        std::unique_lock< std::mutex > lock_j( jobsMut_, std::defer_lock );
+        LockTimed( lock_w, SchedulerStat::WORKERS_LOCK_WAIT );
+        LockTimed( lock_j, SchedulerStat::JOBS_LOCK_WAIT );
 
-        WorkerPtr &w = nodeState.GetWorker();
-        if ( !w->IsAvailable() )
-            continue;
+        PlanGangJob();
+        while( !readyTasks_.empty() && tasks.size() - numTasks < maxTasks )
+        {
+            tasks.push_back( readyTasks_.front() );
+            readyTasks_.pop_front();
+        }
 
-        if ( GetJobForWorker( w, workerJob, job, numFreeCPU ) )
+        bool planned = true;
+        int numNodes = 0;
+        numJobsExamined_ = 0;
+
+        auto visitor = [&]( NodeState &nodeState ) -> bool
         {
-            w->GetJob() += workerJob;
-            hostIP = w->GetIP();
+            ++numNodes;
+            tasks.emplace_back();
+            TaskToSend &task = tasks.back();
+            if ( PlanTaskToSend( nodeState, task.workerJob_, task.hostIP_, task.job_ ) )
+            {
+                planned = true;
+                // each placed task is a separate decision
+                stat_.Add( SchedulerStat::NODES_EXAMINED, numNodes );
+                stat_.Add( SchedulerStat::JOBS_EXAMINED, numJobsExamined_ );
+                numNodes = 0;
+                numJobsExamined_ = 0;
+            }
+            else
+            {
+                tasks.pop_back();
+            }
+            return tasks.size() - numTasks >= maxTasks;
+        };
 
-            const int numTasks = workerJob.GetTotalNumTasks();
-            nodeState.AllocCPU( numTasks );
-            simultExecCnt_[ workerJob.GetJobId() ] += numTasks;
+        while( planned && tasks.size() - numTasks < maxTasks )
+        {
+            planned = false;
+            VisitNodes( visitor );
+        }
 
-            PLOG_DBG( "Scheduler::GetTaskToSend: jobId=" << workerJob.GetJobId() <<
-                      ", numTasks=" << numTasks << ", host=" << w->GetHost() << ", ip=" << hostIP <<
-                      ", freeCPU=" << numFreeCPU << ", totalCPU=" << w->GetNumCPU() <<
-                      ", memory=" << w->GetMemorySize() );
-            return true;
+        if ( numNodes > 0 )
+        {
+            // unsuccessful walk
+            stat_.Add( SchedulerStat::NODES_EXAMINED, numNodes );
+            stat_.Add( SchedulerStat::JOBS_EXAMINED, numJobsExamined_ );
         }
     }
+    stat_.Add( SchedulerStat::GET_TASK_TIME, SchedulerStat::GetTimeMicros() - start );
+
+    if ( tasks.size() > numTasks )
+        return true;
 
     // if there is any worker available, but all queued jobs are
     // sended to workers, then take next job from job mgr queue
-    lock_j.unlock();
-    lock_w.unlock();
     OnNewJob();
-
     return false;
 }
 
@@ -399,8 +890,8 @@ void Scheduler::OnTaskSendCompletion( bool success, const WorkerJob &workerJob,
                   " jobId=" << workerJob.GetJobId() << ", ip=" << hostIP );
 
             std::unique_lock< std::mutex > lock( workersMut_ );
+            JobPtr j;
             {
-                JobPtr j;
                 std::unique_lock< std::mutex > lock_j( jobsMut_ );
                 if ( !jobs_.FindJobByJobId( workerJob.GetJobId(), j ) )
                     return;
@@ -410,17 +901,18 @@ void Scheduler::OnTaskSendCompletion( bool success, const WorkerJob &workerJob,
             if ( it == nodeState_.end() )
                 return;
 
-            if ( failedWorkers_.Add( workerJob.GetJobId(), hostIP ) )
+            if ( failedWorkers_.Add( workerJob.GetJobId(), w->GetHostId() ) )
             {
                 const int numTasks = workerJob.GetTotalNumTasks();
                 NodeState &nodeState = it->second;
                 nodeState.FreeCPU( numTasks );
-                UpdateNodePriority( hostIP, &nodeState );
+                nodeState.FreeMemory( numTasks * j->GetTaskMemory() );
+                UpdateNodePriority( w->GetHostId(), &nodeState );
 
                 // worker job should be rescheduled to any other node
+                w->GetJob().DeleteJob( workerJob.GetJobId() );
+                std::unique_lock< std::mutex > lock_j( jobsMut_ );
                 RescheduleJob( workerJob );
-                WorkerJob &workerJob = w->GetJob();
-                workerJob.DeleteJob( workerJob.GetJobId() );
             }
             else
             {
@@ -435,96 +927,154 @@ void Scheduler::OnTaskSendCompletion( bool success, const WorkerJob &workerJob,
 
 void Scheduler::OnTaskCompletion( int errCode, int64_t execTime, const WorkerTask &workerTask, const std::string &hostIP )
 {
-    if ( !errCode )
+    if ( errCode == NODE_JOB_COMPLETION_NOT_FOUND )
+        return;
+
+    WorkerPtr w;
+    auto workerManager = common::GetService< IWorkerManager >();
+    if ( !workerManager->GetWorkerByIP( hostIP, w ) )
+        return;
+
+    const int64_t start = SchedulerStat::GetTimeMicros();
+    bool processed;
     {
-        WorkerPtr w;
-        auto workerManager = common::GetService< IWorkerManager >();
-        if ( !workerManager->GetWorkerByIP( hostIP, w ) )
-            return;
+        std::unique_lock< std::mutex > lock_w( workersMut_, std::defer_lock );
+        std::unique_lock< std::mutex > lock_j( jobsMut_, std::defer_lock );
+        LockTimed( lock_w, SchedulerStat::WORKERS_LOCK_WAIT );
+        LockTimed( lock_j, SchedulerStat::JOBS_LOCK_WAIT );
+        processed = ProcessTaskCompletion( errCode, execTime, workerTask, hostIP, w );
+    }
+    stat_.Add( SchedulerStat::TASK_COMPLETION_TIME, SchedulerStat::GetTimeMicros() - start );
 
-        std::unique_lock< std::mutex > lock_w( workersMut_ );
-        std::unique_lock< std::mutex > lock_j( jobsMut_ );
+    if ( processed )
+        NotifyAll();
+}
 
+void Scheduler::OnTaskCompletions( const TaskCompletions &completions )
+{
+    // workers are found out of the scheduler lock section
+    std::vector< WorkerPtr > workers( completions.size() );
+    auto workerManager = common::GetService< IWorkerManager >();
+    for( size_t i = 0; i < completions.size(); ++i )
+    {
+        const TaskCompletion &completion = completions[i];
+        if ( completion.errCode_ != NODE_JOB_COMPLETION_NOT_FOUND )
+            workerManager->GetWorkerByIP( completion.hostIP_, workers[i] );
+    }
+
+    const int64_t start = SchedulerStat::GetTimeMicros();
+    bool processed = false;
+    {
+        std::unique_lock< std::mutex > lock_w( workersMut_, std::defer_lock );
+        std::unique_lock< std::mutex > lock_j( jobsMut_, std::defer_lock );
+        LockTimed( lock_w, SchedulerStat::WORKERS_LOCK_WAIT );
+        LockTimed( lock_j, SchedulerStat::JOBS_LOCK_WAIT );
+
+        for( size_t i = 0; i < completions.size(); ++i )
         {
-            JobPtr j;
-            if ( !jobs_.FindJobByJobId( workerTask.GetJobId(), j ) )
-                return;
+            if ( !workers[i] )
+                continue;
+
+            const TaskCompletion &completion = completions[i];
+            if ( ProcessTaskCompletion( completion.errCode_, completion.execTime_,
+                                        completion.workerTask_, completion.hostIP_, workers[i] ) )
+                processed = true;
         }
+    }
+
+    stat_.Add( SchedulerStat::TASK_COMPLETION_TIME, SchedulerStat::GetTimeMicros() - start );
+
+    // the only wakeup for the whole batch
+    if ( processed )
+        NotifyAll();
+}
+
+bool Scheduler::ProcessTaskCompletion( int errCode, int64_t execTime, const WorkerTask &workerTask,
+                                       const std::string &hostIP, WorkerPtr &w )
+{
+    JobPtr j;
+    if ( !jobs_.FindJobByJobId( workerTask.GetJobId(), j ) )
+        return false;
+
+    auto it = nodeState_.find( hostIP );
+    if ( it == nodeState_.end() )
+        return false;
+
+    NodeState &nodeState = it->second;
+    WorkerJob &workerJob = w->GetJob();
 
-        WorkerJob &workerJob = w->GetJob();
+    if ( !errCode )
+    {
         if ( !workerJob.DeleteTask( workerTask.GetJobId(), workerTask.GetTaskId() ) )
         {
             // task already processed.
             // it happens when a few threads simultaneously get success errCode from the same task
             // or after timeout
-            return;
+            return false;
         }
 
-        auto it = nodeState_.find( hostIP );
-        if ( it == nodeState_.end() )
-            return;
-
-        NodeState &nodeState = it->second;
         nodeState.FreeCPU( 1 );
-        UpdateNodePriority( hostIP, &nodeState );
+        nodeState.FreeMemory( j->GetTaskMemory() );
+        UpdateNodePriority( w->GetHostId(), &nodeState );
         simultExecCnt_[ workerTask.GetJobId() ] -= 1;
 
+        if ( !workerJob.HasJob( workerTask.GetJobId() ) )
+        {
+            auto it_hosts = jobHosts_.find( workerTask.GetJobId() );
+            if ( it_hosts != jobHosts_.end() )
+                it_hosts->second.erase( hostIP );
+        }
+
+        FairShare::Instance().AddUsage( j->GetQueue(), 1, j->GetTaskMemory(), execTime );
+        if ( backfill_ )
+            runtimeStat_.Add( GetRuntimeKey( j ), execTime );
+
+        if ( speculation_ )
+        {
+            // the first completed copy wins, so stop other copies
+            stragglers_.OnTaskCompletion( workerTask.GetJobId(), workerTask.GetTaskId(), execTime );
+            if ( stragglers_.IsSpeculated( workerTask.GetJobId(), workerTask.GetTaskId() ) )
+                StopTaskCopies( workerTask.GetJobId(), workerTask.GetTaskId(), j->GetTaskMemory() );
+        }
+
         PLOG( "Scheduler::OnTaskCompletion: jobId=" << workerTask.GetJobId() <<
               ", taskId=" << workerTask.GetTaskId() << ", execTime=" << execTime << " ms"
               ", ip=" << hostIP );
 
         jobs_.DecrementJobExecution( workerTask.GetJobId(), 1, true );
+        return true;
     }
-    else
-    {
-        if ( errCode == NODE_JOB_COMPLETION_NOT_FOUND )
-            return;
-
-        WorkerPtr w;
-        auto workerManager = common::GetService< IWorkerManager >();
-        if ( !workerManager->GetWorkerByIP( hostIP, w ) )
-            return;
 
-        std::unique_lock< std::mutex > lock_w( workersMut_ );
-        {
-            JobPtr j;
-            std::unique_lock< std::mutex > lock_j( jobsMut_ );
-            if ( !jobs_.FindJobByJobId( workerTask.GetJobId(), j ) )
-                return;
-        }
+    // task is already stopped by the scheduler (e.g. preempted)
+    if ( !workerJob.HasTask( workerTask.GetJobId(), workerTask.GetTaskId() ) )
+        return false;
 
-        auto it = nodeState_.find( hostIP );
-        if ( it == nodeState_.end() )
-            return;
+    PLOG( "Scheduler::OnTaskCompletion: errCode=" << common::GetErrorDescription( errCode ) <<
+          ", jobId=" << workerTask.GetJobId() <<
+          ", taskId=" << workerTask.GetTaskId() << ", ip=" << hostIP );
 
-        PLOG( "Scheduler::OnTaskCompletion: errCode=" << common::GetErrorDescription( errCode ) <<
-              ", jobId=" << workerTask.GetJobId() <<
-              ", taskId=" << workerTask.GetTaskId() << ", ip=" << hostIP );
+    if ( !failedWorkers_.Add( workerTask.GetJobId(), w->GetHostId() ) )
+    {
+        PLOG_WRN( "Scheduler::OnTaskCompletion: job already completed" <<
+                  ", jobId=" << workerTask.GetJobId() <<
+                  ", taskId=" << workerTask.GetTaskId() << ", ip=" << hostIP );
+        return false;
+    }
 
-        if ( failedWorkers_.Add( workerTask.GetJobId(), hostIP ) )
-        {
-            WorkerJob jobToReschedule;
-            jobToReschedule.AddTask( workerTask.GetJobId(), workerTask.GetTaskId() );
+    // failed task also consumed the queue share
+    FairShare::Instance().AddUsage( j->GetQueue(), 1, j->GetTaskMemory(), execTime );
 
-            NodeState &nodeState = it->second;
-            nodeState.FreeCPU( 1 );
-            UpdateNodePriority( hostIP, &nodeState );
+    WorkerJob jobToReschedule;
+    jobToReschedule.AddTask( workerTask.GetJobId(), workerTask.GetTaskId() );
 
-            // worker task should be rescheduled to any other node
-            RescheduleJob( jobToReschedule );
-            WorkerJob &workerJob = w->GetJob();
-            workerJob.DeleteTask( workerTask.GetJobId(), workerTask.GetTaskId() );
-        }
-        else
-        {
-            PLOG_WRN( "Scheduler::OnTaskCompletion: job already completed" <<
-                      ", jobId=" << workerTask.GetJobId() <<
-                      ", taskId=" << workerTask.GetTaskId() << ", ip=" << hostIP );
-            return;
-        }
-    }
+    nodeState.FreeCPU( 1 );
+    nodeState.FreeMemory( j->GetTaskMemory() );
+    UpdateNodePriority( w->GetHostId(), &nodeState );
 
-    NotifyAll();
+    // worker task should be rescheduled to any other node
+    workerJob.DeleteTask( workerTask.GetJobId(), workerTask.GetTaskId() );
+    RescheduleJob( jobToReschedule );
+    return true;
 }
 
 void Scheduler::OnTaskTimeout( const WorkerTask &workerTask, const std::string &hostIP )
@@ -579,46 +1129,57 @@ void Scheduler::StopJob( int64_t jobId )
 
 void Scheduler::StopJobGroup( int64_t groupId )
 {
-    std::list< JobPtr > jobs;
     {
+        std::unique_lock< std::mutex > lock_w( workersMut_ );
         std::unique_lock< std::mutex > lock_j( jobsMut_ );
+
+        std::list< JobPtr > jobs;
         jobs_.GetJobGroup( groupId, jobs );
+        for( const auto &job : jobs )
+        {
+            StopWorkers( job->GetJobId() );
+            jobs_.RemoveJob( job->GetJobId(), false, "timeout" );
+        }
     }
-    for( const auto &job : jobs )
-    {
-        StopJob( job->GetJobId() );
-    }
+    NotifyAll();
 }
 
 void Scheduler::StopNamedJob( const std::string &name )
 {
-    std::set< int64_t > jobs;
     {
+        std::unique_lock< std::mutex > lock_w( workersMut_ );
         std::unique_lock< std::mutex > lock_j( jobsMut_ );
+
+        std::set< int64_t > jobs;
         jobs_.GetJobsByName( name, jobs );
+        for( auto jobId : jobs )
+        {
+            StopWorkers( jobId );
+            jobs_.RemoveJob( jobId, false, "timeout" );
+        }
     }
-    for( auto jobId : jobs )
-    {
-        StopJob( jobId );
-    }
+    NotifyAll();
 }
 
 void Scheduler::StopAllJobs()
 {
-    std::vector< int64_t > jobs;
     {
+        std::unique_lock< std::mutex > lock_w( workersMut_ );
         std::unique_lock< std::mutex > lock_j( jobsMut_ );
 
-        for( auto it = jobs_.GetJobQueueBegin(); it != jobs_.GetJobQueueEnd(); ++it )
+        std::vector< int64_t > jobs;
+        jobs_.ForEachJob( [&jobs]( const JobState &jobState )
+        {
+            jobs.push_back( jobState.GetJob()->GetJobId() );
+        } );
+
+        for( int64_t jobId : jobs )
         {
-            const int64_t jobId = it->second;
-            jobs.push_back( jobId );
+            StopWorkers( jobId );
+            jobs_.RemoveJob( jobId, false, "timeout" );
         }
     }
-    for( int64_t jobId : jobs )
-    {
-        StopJob( jobId );
-    }
+    NotifyAll();
 
     // send stop all command
     {
@@ -636,23 +1197,434 @@ void Scheduler::StopAllJobs()
     }
 }
 
+void Scheduler::CheckStragglers()
+{
+    if ( !speculation_ )
+        return;
+
+    bool found = false;
+    {
+        std::unique_lock< std::mutex > lock_w( workersMut_ );
+        std::unique_lock< std::mutex > lock_j( jobsMut_ );
+
+        auto visitor = [&]( int64_t jobId, int taskId ) -> void
+        {
+            JobPtr job;
+            if ( !jobs_.FindJobByJobId( jobId, job ) )
+                return;
+
+            PLOG( "Scheduler::CheckStragglers: speculative execution of jobId=" << jobId <<
+                  ", taskId=" << taskId );
+
+            common::IntervalSet &tasks = speculative_[ jobId ];
+            if ( tasks.empty() )
+                specJobs_.Add( job );
+            tasks.insert( taskId );
+            found = true;
+        };
+
+        stragglers_.VisitStragglers( GetTimeMillis(), visitor );
+    }
+
+    if ( found )
+        NotifyAll();
+}
+
+void Scheduler::CheckGangReservation()
+{
+    if ( gangTimeout_ <= 0 )
+        return;
+
+    {
+        std::unique_lock< std::mutex > lock_w( workersMut_ );
+        std::unique_lock< std::mutex > lock_j( jobsMut_ );
+
+        if ( !gang_.job_ || GetTimeMillis() - gang_.startTime_ < gangTimeout_ * 1000LL )
+            return;
+
+        const int64_t jobId = gang_.job_->GetJobId();
+        PLOG( "Scheduler::CheckGangReservation: reservation timeout, jobId=" << jobId );
+
+        StopWorkers( jobId );
+        jobs_.RemoveJob( jobId, false, "gang reservation timeout" );
+    }
+    NotifyAll();
+}
+
+void Scheduler::PlanGangJob()
+{
+    if ( !gang_.job_ )
+    {
+        if ( gangJobs_.empty() )
+            return;
+
+        // the only one gang job holds capacity at a time, so gang
+        // jobs don't deadlock each other with partial reservations
+        gang_.job_ = *gangJobs_.begin();
+        gang_.startTime_ = GetTimeMillis();
+        gangJobs_.erase( gangJobs_.begin() );
+    }
+
+    auto it = tasksToSend_.find( gang_.job_->GetJobId() );
+    if ( it != tasksToSend_.end() )
+    {
+        common::IntervalSet &tasks = it->second;
+
+        auto visitor = [&]( NodeState &nodeState ) -> bool
+        {
+            ReserveGangTask( nodeState, tasks );
+            return tasks.empty();
+        };
+
+        if ( !VisitNodes( visitor ) )
+            return;
+
+        tasksToSend_.erase( it );
+    }
+
+    DispatchGangJob();
+}
+
+bool Scheduler::ReserveGangTask( NodeState &nodeState, common::IntervalSet &tasks )
+{
+    const JobPtr &job = gang_.job_;
+    const int64_t jobId = job->GetJobId();
+    WorkerPtr &w = nodeState.GetWorker();
+
+    if ( tasks.empty() || !w->IsAvailable() )
+        return false;
+
+    if ( failedWorkers_.IsWorkerFailedJob( w->GetHostId(), jobId ) )
+        return false;
+
+    if ( !job->IsHostPermitted( w->GetHost() ) ||
+         !job->IsGroupPermitted( w->GetGroup() ) )
+        return false;
+
+    // reserved capacity is already allocated, so
+    // only the free node resources are checked here
+    if ( nodeState.GetNumFreeCPU() < 1 || nodeState.GetFreeMemory() < job->GetTaskMemory() )
+        return false;
+
+    const WorkerJob &workerJob = w->GetJob();
+    if ( workerJob.IsExclusive() || ( job->IsExclusive() && workerJob.GetNumJobs() > 0 ) )
+        return false;
+
+    auto it = gang_.reserved_.find( w->GetIP() );
+    const int numReserved = ( it != gang_.reserved_.end() ) ? it->second.GetNumTasks( jobId ) : 0;
+
+    const int maxWorkerInstances = job->GetMaxWorkerInstances();
+    if ( maxWorkerInstances > 0 && numReserved >= maxWorkerInstances )
+        return false;
+
+    const int maxExecAtWorker = job->GetMaxExecAtWorker();
+    if ( maxExecAtWorker > 0 &&
+         numReserved + history_.GetNumExec( jobId, w->GetHostId() ) >= maxExecAtWorker )
+        return false;
+
+    const int taskId = *tasks.begin();
+    WorkerJob &reserved = gang_.reserved_[ w->GetIP() ];
+    reserved.AddTask( jobId, taskId );
+    reserved.SetExclusive( job->IsExclusive() );
+    tasks.erase( taskId );
+
+    nodeState.AllocCPU( 1 );
+    nodeState.AllocMemory( job->GetTaskMemory() );
+    UpdateNodePriority( w->GetHostId(), &nodeState );
+    return true;
+}
+
+void Scheduler::DispatchGangJob()
+{
+    const JobPtr job = gang_.job_;
+    const int64_t jobId = job->GetJobId();
+
+    for( const auto &it : gang_.reserved_ )
+    {
+        const std::string &hostIP = it.first;
+        const WorkerJob &workerJob = it.second;
+
+        NodeState &nodeState = nodeState_[ hostIP ];
+        WorkerPtr &w = nodeState.GetWorker();
+        w->GetJob() += workerJob;
+        jobHosts_[ jobId ].insert( hostIP );
+
+        const int numTasks = workerJob.GetTotalNumTasks();
+        simultExecCnt_[ jobId ] += numTasks;
+        if ( job->GetMaxExecAtWorker() > 0 )
+        {
+            for( int i = 0; i < numTasks; ++i )
+                history_.IncrementNumExec( jobId, w->GetHostId() );
+        }
+
+        if ( backfill_ )
+        {
+            int64_t execTime;
+            nodeState.ExtendDrainTime( PredictTaskRuntime( job, execTime ) ?
+                                       GetTimeMillis() + execTime : std::numeric_limits< int64_t >::max() );
+        }
+
+        readyTasks_.push_back( TaskToSend{ workerJob, hostIP, job } );
+    }
+
+    PLOG( "Scheduler::DispatchGangJob: jobId=" << jobId << ", numHosts=" << gang_.reserved_.size() <<
+          ", waitTime=" << GetTimeMillis() - gang_.startTime_ << " ms" );
+
+    gang_ = GangReservation();
+}
+
+void Scheduler::ReleaseGangReservation()
+{
+    const int64_t taskMemory = gang_.job_->GetTaskMemory();
+
+    for( const auto &it : gang_.reserved_ )
+    {
+        auto it_node = nodeState_.find( it.first );
+        if ( it_node == nodeState_.end() )
+            continue;
+
+        NodeState &nodeState = it_node->second;
+        const int numTasks = it.second.GetTotalNumTasks();
+        nodeState.FreeCPU( numTasks );
+        nodeState.FreeMemory( numTasks * taskMemory );
+        UpdateNodePriority( nodeState.GetWorker()->GetHostId(), &nodeState );
+    }
+
+    gang_ = GangReservation();
+}
+
+void Scheduler::ReleaseGangNode( const std::string &hostIP )
+{
+    // node resources are already released, so only
+    // return its reserved tasks back to the pending ones
+    std::unique_lock< std::mutex > lock_j( jobsMut_ );
+
+    auto it = gang_.reserved_.find( hostIP );
+    if ( it == gang_.reserved_.end() )
+        return;
+
+    const int64_t jobId = gang_.job_->GetJobId();
+    WorkerJob::Tasks tasks;
+    it->second.GetTasks( jobId, tasks );
+
+    common::IntervalSet &pending = tasksToSend_[ jobId ];
+    for( auto taskId : tasks )
+    {
+        pending.insert( taskId );
+    }
+    gang_.reserved_.erase( it );
+}
+
+void Scheduler::EraseGangJob( int64_t jobId )
+{
+    if ( gang_.job_ && gang_.job_->GetJobId() == jobId )
+        ReleaseGangReservation();
+
+    for( auto it = gangJobs_.begin(); it != gangJobs_.end(); ++it )
+    {
+        if ( (*it)->GetJobId() == jobId )
+        {
+            gangJobs_.erase( it );
+            break;
+        }
+    }
+}
+
+void Scheduler::CheckPreemption()
+{
+    if ( preemptionBudget_ <= 0 )
+        return;
+
+    if ( PreemptTasks() )
+        NotifyAll();
+}
+
+bool Scheduler::PreemptTasks()
+{
+    std::unique_lock< std::mutex > lock_w( workersMut_ );
+    std::unique_lock< std::mutex > lock_j( jobsMut_ );
+
+    if ( tasksToSend_.empty() )
+        return false;
+
+    const int64_t now = GetTimeMillis();
+    if ( now - preemptionWindow_ >= 60 * 1000 )
+    {
+        preemptionWindow_ = now;
+        numPreempted_ = 0;
+    }
+
+    bool found = false;
+    for( auto &it : nodeState_ )
+    {
+        if ( numPreempted_ >= preemptionBudget_ )
+            break;
+
+        if ( PreemptTasksAtWorker( it.second ) )
+            found = true;
+    }
+    return found;
+}
+
+bool Scheduler::PreemptTasksAtWorker( NodeState &nodeState )
+{
+    WorkerPtr &w = nodeState.GetWorker();
+    if ( !w->IsAvailable() )
+        return false;
+
+    // the most prioritized job, waiting for the worker
+    JobPtr job;
+    auto visitor = [&]( const JobPtr &candidate ) -> bool
+    {
+        if ( failedWorkers_.IsWorkerFailedJob( w->GetHostId(), candidate->GetJobId() ) )
+            return false;
+
+        if ( !candidate->IsHostPermitted( w->GetHost() ) ||
+             !candidate->IsGroupPermitted( w->GetGroup() ) )
+            return false;
+
+        job = candidate;
+        return true;
+    };
+
+    if ( !eligibleJobs_.Visit( w, visitor ) || job->IsExclusive() )
+        return false;
+
+    // less prioritized tasks are preempted first; tasks of gang, exclusive
+    // jobs and speculative copies are never preempted
+    std::vector< std::pair< JobPtr, int > > victims;
+    std::vector< WorkerTask > tasks;
+    w->GetJob().GetTasks( tasks );
+    for( const auto &task : tasks )
+    {
+        JobPtr victim;
+        if ( !jobs_.FindJobByJobId( task.GetJobId(), victim ) )
+            continue;
+
+        if ( victim->GetPriority() <= job->GetPriority() ||
+             victim->IsGang() || victim->IsExclusive() ||
+             stragglers_.IsSpeculated( task.GetJobId(), task.GetTaskId() ) )
+            continue;
+
+        victims.emplace_back( victim, task.GetTaskId() );
+    }
+
+    if ( victims.empty() )
+        return false;
+
+    std::stable_sort( victims.begin(), victims.end(),
+        []( const std::pair< JobPtr, int > &a, const std::pair< JobPtr, int > &b )
+        {
+            return a.first->GetPriority() > b.first->GetPriority();
+        } );
+
+    const int64_t jobId = job->GetJobId();
+    WorkerJob plannedJob;
+    size_t numVictims = 0;
+
+    while( true )
+    {
+        PlanJobTasks( tasksToSend_, eligibleJobs_, nodeState, plannedJob, job );
+        if ( tasksToSend_.find( jobId ) == tasksToSend_.end() )
+            break;
+
+        if ( numVictims >= victims.size() || numPreempted_ >= preemptionBudget_ )
+            break;
+
+        const auto &victim = victims[ numVictims++ ];
+        PreemptTask( nodeState, victim.first, victim.second );
+    }
+
+    if ( plannedJob.GetTotalNumTasks() < 1 )
+        return numVictims > 0;
+
+    CommitTaskToSend( nodeState, plannedJob, job );
+    readyTasks_.push_back( TaskToSend{ plannedJob, w->GetIP(), job } );
+
+    PLOG( "Scheduler::PreemptTasksAtWorker: jobId=" << jobId <<
+          ", numTasks=" << plannedJob.GetTotalNumTasks() << ", numPreempted=" << numVictims <<
+          ", ip=" << w->GetIP() );
+    return true;
+}
+
+void Scheduler::PreemptTask( NodeState &nodeState, const JobPtr &job, int taskId )
+{
+    const int64_t jobId = job->GetJobId();
+    WorkerPtr &w = nodeState.GetWorker();
+    WorkerJob &workerJob = w->GetJob();
+
+    if ( !workerJob.DeleteTask( jobId, taskId ) )
+        return;
+
+    CommandPtr commandPtr = std::make_shared< StopTaskCommand >();
+    commandPtr->SetParam( "job_id", jobId );
+    commandPtr->SetParam( "task_id", taskId );
+    auto workerManager = common::GetService< IWorkerManager >();
+    workerManager->AddCommand( commandPtr, w->GetIP() );
+
+    nodeState.FreeCPU( 1 );
+    nodeState.FreeMemory( job->GetTaskMemory() );
+    UpdateNodePriority( w->GetHostId(), &nodeState );
+    simultExecCnt_[ jobId ] -= 1;
+
+    if ( !workerJob.HasJob( jobId ) )
+    {
+        auto it_hosts = jobHosts_.find( jobId );
+        if ( it_hosts != jobHosts_.end() )
+            it_hosts->second.erase( w->GetIP() );
+    }
+
+    if ( speculation_ )
+        stragglers_.OnTaskStop( jobId, taskId );
+
+    // preempted task isn't failed, so it is requeued
+    // without marking the worker as failed for the job
+    common::IntervalSet &pending = tasksToSend_[ jobId ];
+    if ( pending.empty() )
+        eligibleJobs_.Add( job );
+    pending.insert( taskId );
+    ++numPreempted_;
+
+    PLOG( "Scheduler::PreemptTask: jobId=" << jobId << ", taskId=" << taskId << ", ip=" << w->GetIP() );
+}
+
 void Scheduler::OnRemoveJob( int64_t jobId, bool success )
 {
+    EraseGangJob( jobId );
+    readyTasks_.remove_if( [jobId]( const TaskToSend &task ) { return task.job_->GetJobId() == jobId; } );
+    ErasePendingTasks( tasksToSend_, eligibleJobs_, jobId );
+    ErasePendingTasks( needReschedule_, reschedJobs_, jobId );
+    ErasePendingTasks( speculative_, specJobs_, jobId );
+    stragglers_.RemoveJob( jobId );
     simultExecCnt_.erase( jobId );
+    jobHosts_.erase( jobId );
+    localityWait_.erase( jobId );
     history_.RemoveJob( jobId );
     failedWorkers_.Delete( jobId );
 
-    auto jobEventReceiver = common::GetService< IJobEventReceiver >();
-    jobEventReceiver->OnJobDelete( jobId );
+    jobs_.PostEffect( [jobId]()
+    {
+        auto jobEventReceiver = common::GetService< IJobEventReceiver >();
+        jobEventReceiver->OnJobDelete( jobId );
+    } );
 }
 
 void Scheduler::StopWorkers( int64_t jobId )
 {
+    auto it_hosts = jobHosts_.find( jobId );
+    if ( it_hosts != jobHosts_.end() )
     {
         auto workerManager = common::GetService< IWorkerManager >();
 
-        for( auto it = nodeState_.begin(); it != nodeState_.end(); ++it )
+        JobPtr job;
+        const int64_t taskMemory = jobs_.FindJobByJobId( jobId, job ) ? job->GetTaskMemory() : 0;
+
+        for( const auto &hostIP : it_hosts->second )
         {
+            auto it = nodeState_.find( hostIP );
+            if ( it == nodeState_.end() )
+                continue;
+
             NodeState &nodeState = it->second;
             WorkerPtr &worker = nodeState.GetWorker();
             WorkerJob &workerJob = worker->GetJob();
@@ -672,23 +1644,18 @@ void Scheduler::StopWorkers( int64_t jobId )
 
                 const int numTasks = workerJob.GetNumTasks( jobId );
                 nodeState.FreeCPU( numTasks );
+                nodeState.FreeMemory( numTasks * taskMemory );
+                UpdateNodePriority( worker->GetHostId(), &nodeState );
                 workerJob.DeleteJob( jobId );
             }
         }
-    }
 
-    tasksToSend_.erase( jobId );
-    {
-        for( auto it = needReschedule_.begin(); it != needReschedule_.end(); )
-        {
-            if ( it->GetJobId() == jobId )
-            {
-                needReschedule_.erase( it++ );
-                continue;
-            }
-            ++it;
-        }
+        jobHosts_.erase( it_hosts );
     }
+
+    ErasePendingTasks( tasksToSend_, eligibleJobs_, jobId );
+    ErasePendingTasks( needReschedule_, reschedJobs_, jobId );
+    ErasePendingTasks( speculative_, specJobs_, jobId );
 }
 
 void Scheduler::StopWorker( const std::string &hostIP ) const
@@ -714,23 +1681,37 @@ void Scheduler::StopWorker( const std::string &hostIP ) const
     }
 }
 
+void Scheduler::LockTimed( std::unique_lock< std::mutex > &lock, SchedulerStat::Metric metric )
+{
+    // uncontended acquisition doesn't pay for the clock reading
+    if ( lock.try_lock() )
+    {
+        stat_.Add( metric, 0 );
+        return;
+    }
+
+    const int64_t start = SchedulerStat::GetTimeMicros();
+    lock.lock();
+    stat_.Add( metric, SchedulerStat::GetTimeMicros() - start );
+}
+
 bool Scheduler::CanTakeNewJob()
 {
     std::unique_lock< std::mutex > lock_w( workersMut_ );
 
-    auto it = nodePriority_.right.rbegin();
-    if ( it != nodePriority_.right.rend() )
+    for( const auto &shard : shards_ )
     {
-        const NodeState &nodeState = *(it->first);
-        return nodeState.GetNumFreeCPU() > 0;
+        if ( shard.second.nodeIndex_.GetMaxFreeCPU() > 0 )
+            return true;
     }
 
     return false;
 }
 
-bool Scheduler::CanAddTaskToWorker( const WorkerPtr &worker, const WorkerJob &workerPlannedJob,
+bool Scheduler::CanAddTaskToWorker( const NodeState &nodeState, const WorkerJob &workerPlannedJob,
                                     int64_t jobId, const JobPtr &job ) const
 {
+    const WorkerPtr &worker = nodeState.GetWorker();
     const WorkerJob &workerJob = worker->GetJob();
 
     // job exclusive case
@@ -767,7 +1748,7 @@ bool Scheduler::CanAddTaskToWorker( const WorkerPtr &worker, const WorkerJob &wo
 
     if ( job->GetMaxExecAtWorker() > 0 )
     {
-        if ( history_.GetNumExec( jobId, worker->GetIP() ) >= job->GetMaxExecAtWorker() )
+        if ( history_.GetNumExec( jobId, worker->GetHostId() ) >= job->GetMaxExecAtWorker() )
             return false;
 
         const int numTasks = workerJob.GetNumTasks( jobId ) + workerPlannedJob.GetNumTasks( jobId );
@@ -775,6 +1756,15 @@ bool Scheduler::CanAddTaskToWorker( const WorkerPtr &worker, const WorkerJob &wo
             return false;
     }
 
+    // per-task memory requirement case
+    const int64_t taskMemory = job->GetTaskMemory();
+    if ( taskMemory > 0 )
+    {
+        const int64_t plannedMemory = ( workerPlannedJob.GetNumTasks( jobId ) + 1 ) * taskMemory;
+        if ( plannedMemory > nodeState.GetFreeMemory() )
+            return false;
+    }
+
     return true;
 }
 
@@ -807,6 +1797,55 @@ int Scheduler::GetNumPlannedExec( const JobPtr &job ) const
     return numExec;
 }
 
+bool Scheduler::PredictTaskRuntime( const JobPtr &job, int64_t &execTime ) const
+{
+    if ( runtimeStat_.Predict( GetRuntimeKey( job ), execTime ) )
+        return true;
+
+    // task can't execute longer than its timeout
+    if ( job->GetTaskTimeout() > 0 )
+    {
+        execTime = job->GetTaskTimeout() * 1000;
+        return true;
+    }
+    return false;
+}
+
+const std::string &Scheduler::GetRuntimeKey( const JobPtr &job )
+{
+    return job->GetName().empty() ? job->GetFilePath() : job->GetName();
+}
+
+bool Scheduler::IsLocalityPermitted( const JobPtr &job, uint32_t hostId, int64_t now ) const
+{
+    // delay scheduling: job skips non-local workers
+    // until it waits for the local ones long enough
+    const std::string &key = GetLocalityKey( job );
+    if ( !locality_.HasLocality( key ) || locality_.IsLocal( key, hostId ) )
+        return true;
+
+    auto it = localityWait_.find( job->GetJobId() );
+    if ( it == localityWait_.end() )
+        return true;
+
+    return now - it->second >= localityDelay_ * 1000LL;
+}
+
+const std::string &Scheduler::GetLocalityKey( const JobPtr &job )
+{
+    return job->GetDataSet().empty() ? GetRuntimeKey( job ) : job->GetDataSet();
+}
+
+size_t Scheduler::GetNumNeedReschedule() const
+{
+    size_t num = 0;
+    for( const auto &it : needReschedule_ )
+    {
+        num += it.second.size();
+    }
+    return num;
+}
+
 void Scheduler::Accept( ISchedulerVisitor *visitor )
 {
     std::unique_lock< std::mutex > lock_w( workersMut_ );
@@ -26,22 +26,56 @@ the License.
 #include <set>
 #include <map>
 #include <list>
-#include <boost/bimap/bimap.hpp>
-#include <boost/bimap/multiset_of.hpp>
+#include <vector>
+#include <random>
+#include <algorithm>
 #include <mutex>
 #include "common/observer.h"
 #include "worker.h"
 #include "job.h"
 #include "failed_workers.h"
 #include "scheduled_jobs.h"
+#include "eligible_jobs.h"
 #include "node_state.h"
 #include "worker_priority.h"
+#include "placement_policy.h"
+#include "runtime_stat.h"
+#include "locality_history.h"
+#include "straggler_detector.h"
+#include "scheduler_stat.h"
 
 
 namespace master {
 
 class ISchedulerVisitor;
 
+struct TaskToSend
+{
+    WorkerJob workerJob_;
+    std::string hostIP_;
+    JobPtr job_;
+};
+typedef std::vector< TaskToSend > TasksToSend;
+
+struct TaskCompletion
+{
+    int errCode_;
+    int64_t execTime_;
+    WorkerTask workerTask_;
+    std::string hostIP_;
+};
+typedef std::vector< TaskCompletion > TaskCompletions;
+
+// capacity, held for the tasks of a gang job until all of them fit
+struct GangReservation
+{
+    GangReservation() : startTime_( 0 ) {}
+
+    JobPtr job_;
+    std::map< std::string, WorkerJob > reserved_; // ip -> tasks, reserved on the node
+    int64_t startTime_;
+};
+
 struct IScheduler : virtual public common::IObservable
 {
     virtual void OnHostAppearance( WorkerPtr &worker ) = 0;
@@ -52,10 +86,12 @@ struct IScheduler : virtual public common::IObservable
     virtual void OnNewJob() = 0;
 
     virtual bool GetTaskToSend( WorkerJob &workerJob, std::string &hostIP, JobPtr &job ) = 0;
+    virtual bool GetTasksToSend( TasksToSend &tasks, size_t maxTasks ) = 0;
 
     virtual void OnTaskSendCompletion( bool success, const WorkerJob &workerJob, const std::string &hostIP ) = 0;
 
     virtual void OnTaskCompletion( int errCode, int64_t execTime, const WorkerTask &workerTask, const std::string &hostIP ) = 0;
+    virtual void OnTaskCompletions( const TaskCompletions &completions ) = 0;
 
     virtual void OnTaskTimeout( const WorkerTask &workerTask, const std::string &hostIP ) = 0;
     virtual void OnJobTimeout( int64_t jobId ) = 0;
@@ -65,22 +101,32 @@ struct IScheduler : virtual public common::IObservable
     virtual void StopNamedJob( const std::string &name ) = 0;
     virtual void StopAllJobs() = 0;
 
+    virtual void CheckStragglers() = 0;
+    virtual void CheckGangReservation() = 0;
+    virtual void CheckPreemption() = 0;
+
     virtual void Accept( ISchedulerVisitor *visitor ) = 0;
-};
 
-using namespace boost::bimaps;
+    virtual SchedulerStat &GetStat() = 0;
+};
 
 class Scheduler : public IScheduler,
                   public common::Observable< common::MutexLockPolicy >
 {
 private:
-    typedef bimap< set_of< std::string >, multiset_of< NodeState *, CompareByCPUandMemory > > NodePriorityQueue; // ip -> NodeState
+    // nodes of the same worker group
+    struct NodeShard
+    {
+        NodeIndex nodeIndex_; // nodes by the number of free CPU's
+        std::vector< NodeState * > nodeList_; // random access to the nodes for sampling
+    };
+    typedef std::map< std::string, NodeShard > GroupToShard; // group -> nodes
 
 public:
     typedef std::map< std::string, NodeState > IPToNodeState;
-    typedef std::list< WorkerTask > TaskList;
-    typedef std::map< int64_t, std::set< int > > JobIdToTasks; // job_id -> set(task_id)
+    typedef std::map< int64_t, common::IntervalSet > JobIdToTasks; // job_id -> set(task_id)
     typedef std::map< int64_t, int > JobIdToExecCnt; // job_id -> number of simultaneously running instances of the job
+    typedef std::map< int64_t, std::set< std::string > > JobIdToHosts; // job_id -> set(ip)
 
 public:
     Scheduler();
@@ -93,10 +139,12 @@ public:
     virtual void OnNewJob();
 
     virtual bool GetTaskToSend( WorkerJob &workerJob, std::string &hostIP, JobPtr &job );
+    virtual bool GetTasksToSend( TasksToSend &tasks, size_t maxTasks );
 
     virtual void OnTaskSendCompletion( bool success, const WorkerJob &workerJob, const std::string &hostIP );
 
     virtual void OnTaskCompletion( int errCode, int64_t execTime, const WorkerTask &workerTask, const std::string &hostIP );
+    virtual void OnTaskCompletions( const TaskCompletions &completions );
 
     virtual void OnTaskTimeout( const WorkerTask &workerTask, const std::string &hostIP );
     virtual void OnJobTimeout( int64_t jobId );
@@ -106,43 +154,123 @@ public:
     virtual void StopNamedJob( const std::string &name );
     virtual void StopAllJobs();
 
+    virtual void CheckStragglers();
+    virtual void CheckGangReservation();
+    virtual void CheckPreemption();
+
     virtual void Accept( ISchedulerVisitor *visitor );
 
+    virtual SchedulerStat &GetStat() { return stat_; }
+
     const IPToNodeState &GetNodeState() const { return nodeState_; }
     const FailedWorkers &GetFailedWorkers() const { return failedWorkers_; }
-    const TaskList &GetNeedReschedule() const { return needReschedule_; }
+    const JobIdToTasks &GetNeedReschedule() const { return needReschedule_; }
+    void SetPlacementPolicy( PlacementPolicy policy ) { placementPolicy_ = policy; }
+    void SetBackfill( bool backfill ) { backfill_ = backfill; }
+    void SetSpeculativeExecution( bool speculation ) { speculation_ = speculation; }
+    void SetGangTimeout( int timeout ) { gangTimeout_ = timeout; }
+    void SetPreemptionBudget( int budget ) { preemptionBudget_ = budget; }
+    void SetLocalityDelay( int delay ) { localityDelay_ = delay; }
+    void SetPlanningWindow( int window ) { planningWindow_ = std::max( window, 1 ); }
+    void SetCompletionExecutor( ICompletionExecutor *executor ) { jobs_.SetCompletionExecutor( executor ); }
+    size_t GetNumNeedReschedule() const;
     ScheduledJobs &GetScheduledJobs() { return jobs_; }
 
 private:
-    void UpdateNodePriority( const std::string &ip, NodeState *nodeState );
+    void UpdateNodePriority( uint32_t hostId, NodeState *nodeState );
+    void UpdateCapacity() const;
 
     void PlanJobExecution();
-    bool RescheduleJob( const WorkerJob &workerJob );
-
-    bool GetReschedJobForWorker( const WorkerPtr &worker, WorkerJob &plannedJob, JobPtr &job, int numFreeCPU );
-    bool GetJobForWorker( const WorkerPtr &worker, WorkerJob &plannedJob, JobPtr &job, int numFreeCPU );
+    int PlanNextJob();
+    bool RescheduleJob( const WorkerJob &workerJob ); // jobs mutex must be locked
+
+    bool ProcessTaskCompletion( int errCode, int64_t execTime, const WorkerTask &workerTask,
+                                const std::string &hostIP, WorkerPtr &w );
+
+    bool FindJobForWorker( const EligibleJobs &index, const NodeState &nodeState,
+                           const WorkerJob &plannedJob, JobPtr &job ) const;
+    bool GetReschedJobForWorker( const NodeState &nodeState, WorkerJob &plannedJob, JobPtr &job );
+    template< typename Visitor >
+    bool VisitNodes( Visitor &visitor );
+    template< typename Visitor >
+    bool VisitShard( NodeShard &shard, Visitor &visitor );
+    bool IsShardEligible( const std::string &group ) const;
+    bool PlanTaskToSend( NodeState &nodeState, WorkerJob &workerJob, std::string &hostIP, JobPtr &job );
+    void CommitTaskToSend( NodeState &nodeState, const WorkerJob &workerJob, const JobPtr &job );
+    bool GetJobForWorker( const NodeState &nodeState, WorkerJob &plannedJob, JobPtr &job );
+    void PlanJobTasks( JobIdToTasks &pending, EligibleJobs &index,
+                       const NodeState &nodeState, WorkerJob &plannedJob, const JobPtr &job );
+    void ErasePendingTasks( JobIdToTasks &pending, EligibleJobs &index, int64_t jobId );
+
+    bool PlanSpeculativeTasks( const NodeState &nodeState, WorkerJob &plannedJob, JobPtr &job );
+    bool HasTaskCopy( int64_t jobId, int taskId ) const;
+    void StopTaskCopies( int64_t jobId, int taskId, int64_t taskMemory );
+
+    void PlanGangJob();
+    bool ReserveGangTask( NodeState &nodeState, common::IntervalSet &tasks );
+    void DispatchGangJob();
+    void ReleaseGangReservation();
+    void ReleaseGangNode( const std::string &hostIP );
+    void EraseGangJob( int64_t jobId );
+
+    bool PreemptTasks();
+    bool PreemptTasksAtWorker( NodeState &nodeState );
+    void PreemptTask( NodeState &nodeState, const JobPtr &job, int taskId );
 
     void OnRemoveJob( int64_t jobId, bool success );
     void StopWorkers( int64_t jobId );
     void StopWorker( const std::string &hostIP ) const;
 
+    void LockTimed( std::unique_lock< std::mutex > &lock, SchedulerStat::Metric metric );
+
     bool CanTakeNewJob();
-    bool CanAddTaskToWorker( const WorkerPtr &worker, const WorkerJob &workerPlannedJob,
+    bool CanAddTaskToWorker( const NodeState &nodeState, const WorkerJob &workerPlannedJob,
                              int64_t jobId, const JobPtr &job ) const;
 
     int GetNumPlannedExec( const JobPtr &job ) const;
 
+    bool PredictTaskRuntime( const JobPtr &job, int64_t &execTime ) const;
+    static const std::string &GetRuntimeKey( const JobPtr &job );
+
+    bool IsLocalityPermitted( const JobPtr &job, uint32_t hostId, int64_t now ) const;
+    static const std::string &GetLocalityKey( const JobPtr &job );
+
 private:
     IPToNodeState nodeState_;
-    NodePriorityQueue nodePriority_;
+    GroupToShard shards_;
+    size_t nextShard_; // round robin start of the shards walk
+    PlacementPolicy placementPolicy_;
+    std::mt19937 random_;
     FailedWorkers failedWorkers_;
     std::mutex workersMut_;
 
     ScheduledJobs jobs_;
     JobIdToTasks tasksToSend_;
-    TaskList needReschedule_;
+    EligibleJobs eligibleJobs_; // jobs, having tasks in tasksToSend_
+    JobIdToTasks needReschedule_;
+    EligibleJobs reschedJobs_; // jobs, having tasks in needReschedule_
     JobIdToExecCnt simultExecCnt_;
+    JobIdToHosts jobHosts_; // hosts, which may execute tasks of the job
     JobExecHistory history_;
+    RuntimeStat runtimeStat_; // task execution times per job name
+    bool backfill_;
+    StragglerDetector stragglers_;
+    JobIdToTasks speculative_; // straggler tasks, waiting for their copies placement
+    EligibleJobs specJobs_; // jobs, having tasks in speculative_
+    bool speculation_;
+    std::set< JobPtr, JobPriorityOrder > gangJobs_; // gang jobs, waiting for the reservation
+    GangReservation gang_;
+    int gangTimeout_;
+    std::list< TaskToSend > readyTasks_; // tasks, planned out of the node walk, are sent first
+    int preemptionBudget_; // max number of preempted tasks per minute
+    int numPreempted_;
+    int64_t preemptionWindow_; // start time of the current budget window
+    LocalityHistory locality_;
+    std::map< int64_t, int64_t > localityWait_; // job_id -> start time of waiting for a local worker
+    int localityDelay_; // seconds
+    int planningWindow_; // max number of jobs, taken from the queue at once
+    mutable int numJobsExamined_; // candidate jobs, examined by the current placement decision
+    SchedulerStat stat_;
     std::mutex jobsMut_;
 };
 
@@ -0,0 +1,154 @@
+/*
+===========================================================================
+
+This software is licensed under the Apache 2 license, quoted below.
+
+Copyright (C) 2013 Andrey Budnik <budnik27@gmail.com>
+
+Licensed under the Apache License, Version 2.0 (the "License"); you may not
+use this file except in compliance with the License. You may obtain a copy of
+the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+License for the specific language governing permissions and limitations under
+the License.
+
+===========================================================================
+*/
+
+#ifndef __SCHEDULER_STAT_H
+#define __SCHEDULER_STAT_H
+
+#include <mutex>
+#include <chrono>
+#include <ostream>
+#include <algorithm>
+#include <stdint.h> // int64_t
+
+namespace master {
+
+// Histogram with power of two buckets: bucket i holds values in [2^(i-1), 2^i),
+// so adding a sample is O(1) and percentiles are upper bounds of a bucket.
+class Histogram
+{
+public:
+    static const int NUM_BUCKETS = 40;
+
+public:
+    Histogram() : count_( 0 ), sum_( 0 ), max_( 0 )
+    {
+        for( int i = 0; i < NUM_BUCKETS; ++i )
+            buckets_[i] = 0;
+    }
+
+    void Add( int64_t value )
+    {
+        if ( value < 0 )
+            value = 0;
+
+        int i = 0;
+        for( int64_t v = value; v > 0 && i < NUM_BUCKETS - 1; v >>= 1 )
+            ++i;
+
+        ++buckets_[i];
+        ++count_;
+        sum_ += value;
+        if ( value > max_ )
+            max_ = value;
+    }
+
+    // percentile in range [0, 100]
+    int64_t GetPercentile( int percentile ) const
+    {
+        const int64_t rank = ( count_ * percentile + 99 ) / 100;
+        int64_t num = 0;
+        for( int i = 0; i < NUM_BUCKETS; ++i )
+        {
+            num += buckets_[i];
+            if ( num >= rank && num > 0 )
+                return std::min( max_, i ? ( int64_t( 1 ) << i ) - 1 : int64_t( 0 ) );
+        }
+        return max_;
+    }
+
+    int64_t GetCount() const { return count_; }
+    int64_t GetMax() const { return max_; }
+    int64_t GetMean() const { return count_ ? sum_ / count_ : 0; }
+
+private:
+    int64_t buckets_[ NUM_BUCKETS ];
+    int64_t count_;
+    int64_t sum_;
+    int64_t max_;
+};
+
+// Scheduler latencies, lock waits and per-decision candidate counts,
+// reported by the "stat" admin command.
+class SchedulerStat
+{
+public:
+    enum Metric
+    {
+        GET_TASK_TIME,        // GetTaskToSend/GetTasksToSend call, us
+        TASK_COMPLETION_TIME, // OnTaskCompletion(s) call, us
+        WORKERS_LOCK_WAIT,    // workersMut_ acquisition, us
+        JOBS_LOCK_WAIT,       // jobsMut_ acquisition, us
+        NODES_EXAMINED,       // nodes visited per placement decision
+        JOBS_EXAMINED,        // jobs visited per placement decision
+        SEND_QUEUE_WAIT,      // job sender semaphore wait, us
+        SEND_TIME,            // job sending to a worker node, us
+        NUM_METRICS
+    };
+
+public:
+    void Add( Metric metric, int64_t value )
+    {
+        std::unique_lock< std::mutex > lock( mut_ );
+        histograms_[ metric ].Add( value );
+    }
+
+    void Print( std::ostream &out ) const
+    {
+        static const char *names[ NUM_METRICS ] = {
+            "get task time", "task completion time",
+            "workers lock wait", "jobs lock wait",
+            "nodes examined", "jobs examined",
+            "send queue wait", "send time"
+        };
+        static const char *units[ NUM_METRICS ] = {
+            " us", " us", " us", " us", "", "", " us", " us"
+        };
+
+        std::unique_lock< std::mutex > lock( mut_ );
+        for( int i = 0; i < NUM_METRICS; ++i )
+        {
+            const Histogram &h = histograms_[i];
+            if ( !h.GetCount() )
+                continue;
+
+            out << names[i] << ": n = " << h.GetCount() <<
+                ", mean = " << h.GetMean() << units[i] <<
+                ", p50 = " << h.GetPercentile( 50 ) << units[i] <<
+                ", p99 = " << h.GetPercentile( 99 ) << units[i] <<
+                ", max = " << h.GetMax() << units[i] << std::endl;
+        }
+    }
+
+    static int64_t GetTimeMicros()
+    {
+        using namespace std::chrono;
+        return duration_cast< microseconds >( steady_clock::now().time_since_epoch() ).count();
+    }
+
+private:
+    Histogram histograms_[ NUM_METRICS ];
+    mutable std::mutex mut_;
+};
+
+} // namespace master
+
+#endif
@@ -22,6 +22,7 @@ the License.
 
 #include "statistics.h"
 #include "worker_manager.h"
+#include "job_manager.h"
 #include "common/service_locator.h"
 
 namespace master {
@@ -115,14 +116,13 @@ void AllJobInfo::Visit( Scheduler &scheduler )
 {
     const ScheduledJobs &schedJobs = scheduler.GetScheduledJobs();
 
-    for( auto it = schedJobs.GetJobQueueBegin(); it != schedJobs.GetJobQueueEnd(); ++it )
+    schedJobs.ForEachJob( [&]( const JobState &jobState )
     {
-        const JobState &jobState = it->first;
         const JobPtr &job = jobState.GetJob();
         std::string jobInfo;
         JobInfo::PrintJobInfo( jobInfo, scheduler, job->GetJobId() );
         info_ += jobInfo + '\n';
-    }
+    } );
 }
 
 void Statistics::Visit( Scheduler &scheduler )
@@ -141,23 +141,38 @@ void Statistics::Visit( Scheduler &scheduler )
         "busy cpu's = " << GetNumBusyCPU( scheduler ) << std::endl <<
         "total cpu's = " << workerManager->GetTotalCPU() << std::endl;
 
-    const Scheduler::TaskList &needReschedule = scheduler.GetNeedReschedule();
-
     ss << "jobs = " << schedJobs.GetNumJobs() << std::endl <<
-        "need reschedule = " << needReschedule.size() << std::endl;
+        "need reschedule = " << scheduler.GetNumNeedReschedule() << std::endl;
 
     ss << "executing jobs: {";
-    for( auto it = schedJobs.GetJobQueueBegin(); it != schedJobs.GetJobQueueEnd(); ++it )
+    bool first = true;
+    schedJobs.ForEachJob( [&]( const JobState &jobState )
     {
-        const JobState &jobState = it->first;
         const JobPtr &job = jobState.GetJob();
 
-        if ( it != schedJobs.GetJobQueueBegin() )
+        if ( !first )
             ss << ", ";
         ss << job->GetJobId();
-    }
+        first = false;
+    } );
     ss << "}" << std::endl;
 
+    WaitTimeStat waitTimeStat;
+    IJobManager *jobManager = common::GetService< IJobManager >();
+    jobManager->GetWaitTimeStat( waitTimeStat );
+    if ( !waitTimeStat.Empty() )
+    {
+        ss << "job queue wait times:" << std::endl;
+        waitTimeStat.Print( ss );
+    }
+
+    std::ostringstream schedStat;
+    scheduler.GetStat().Print( schedStat );
+    if ( !schedStat.str().empty() )
+    {
+        ss << "scheduler:" << std::endl << schedStat.str();
+    }
+
     ss << "================";
 
     info_ = ss.str();
@@ -246,6 +261,7 @@ void WorkerStatistics::Visit( Scheduler &scheduler )
 
         ss << "num cpu = " << worker->GetNumCPU() << std::endl <<
             "memory = " << worker->GetMemorySize() << std::endl <<
+            "free memory = " << nodeState.GetFreeMemory() << std::endl <<
             "num executing tasks = " << workerJob.GetTotalNumTasks() << std::endl;
 
         ss << "tasks = {";
@@ -0,0 +1,150 @@
+/*
+===========================================================================
+
+This software is licensed under the Apache 2 license, quoted below.
+
+Copyright (C) 2013 Andrey Budnik <budnik27@gmail.com>
+
+Licensed under the Apache License, Version 2.0 (the "License"); you may not
+use this file except in compliance with the License. You may obtain a copy of
+the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+License for the specific language governing permissions and limitations under
+the License.
+
+===========================================================================
+*/
+
+#ifndef __STRAGGLER_DETECTOR_H
+#define __STRAGGLER_DETECTOR_H
+
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <stdint.h> // int64_t
+#include "common/interval_set.h"
+
+namespace master {
+
+// Finds straggler tasks for the speculative re-execution. A task is a straggler
+// if most tasks of its job are completed, and the task executes much longer
+// than the median execution time of the completed tasks.
+class StragglerDetector
+{
+    struct JobTasks
+    {
+        JobTasks() : numTasks_( 0 ) {}
+
+        std::vector< int64_t > startTime_; // task_id -> start time of the first copy, 0 if not running
+        std::vector< int64_t > execTimes_; // execution times of the completed tasks
+        common::IntervalSet speculated_; // tasks, having speculative copies
+        int numTasks_;
+    };
+
+    typedef std::map< int64_t, JobTasks > JobIdToTasks;
+
+public:
+    StragglerDetector()
+    : minCompleted_( 0.9 ), slowdown_( 2. )
+    {}
+
+    // minCompleted - fraction of completed job tasks, before looking for stragglers,
+    // slowdown - execution time of a straggler in terms of the median execution time
+    void SetThresholds( double minCompleted, double slowdown )
+    {
+        minCompleted_ = minCompleted;
+        slowdown_ = slowdown;
+    }
+
+    void OnTaskStart( int64_t jobId, int numTasks, int taskId, int64_t now )
+    {
+        JobTasks &job = jobs_[ jobId ];
+        if ( job.startTime_.empty() )
+        {
+            job.startTime_.resize( numTasks );
+            job.numTasks_ = numTasks;
+        }
+
+        if ( taskId >= 0 && taskId < job.numTasks_ && !job.startTime_[ taskId ] )
+            job.startTime_[ taskId ] = now;
+    }
+
+    // task is going to be rescheduled, so it isn't running anymore
+    void OnTaskStop( int64_t jobId, int taskId )
+    {
+        auto it = jobs_.find( jobId );
+        if ( it != jobs_.end() )
+        {
+            JobTasks &job = it->second;
+            if ( taskId >= 0 && taskId < job.numTasks_ )
+                job.startTime_[ taskId ] = 0;
+        }
+    }
+
+    void OnTaskCompletion( int64_t jobId, int taskId, int64_t execTime )
+    {
+        auto it = jobs_.find( jobId );
+        if ( it != jobs_.end() )
+        {
+            JobTasks &job = it->second;
+            if ( taskId >= 0 && taskId < job.numTasks_ )
+                job.startTime_[ taskId ] = 0;
+            job.execTimes_.push_back( execTime );
+        }
+    }
+
+    bool IsSpeculated( int64_t jobId, int taskId ) const
+    {
+        auto it = jobs_.find( jobId );
+        return it != jobs_.end() && it->second.speculated_.count( taskId );
+    }
+
+    void RemoveJob( int64_t jobId )
+    {
+        jobs_.erase( jobId );
+    }
+
+    // visits not yet speculated stragglers of all jobs and marks them speculated
+    template< typename Visitor >
+    void VisitStragglers( int64_t now, Visitor visitor )
+    {
+        for( auto &it : jobs_ )
+        {
+            JobTasks &job = it.second;
+            const size_t numCompleted = job.execTimes_.size();
+            if ( !numCompleted || numCompleted < minCompleted_ * job.numTasks_ )
+                continue;
+
+            std::vector< int64_t > &execTimes = job.execTimes_;
+            std::nth_element( execTimes.begin(), execTimes.begin() + numCompleted / 2, execTimes.end() );
+            const int64_t median = execTimes[ numCompleted / 2 ];
+
+            for( int taskId = 0; taskId < job.numTasks_; ++taskId )
+            {
+                const int64_t startTime = job.startTime_[ taskId ];
+                if ( !startTime || now - startTime <= slowdown_ * median )
+                    continue;
+
+                if ( job.speculated_.count( taskId ) )
+                    continue;
+
+                job.speculated_.insert( taskId );
+                visitor( it.first, taskId );
+            }
+        }
+    }
+
+private:
+    JobIdToTasks jobs_;
+    double minCompleted_;
+    double slowdown_;
+};
+
+} // namespace master
+
+#endif
@@ -77,7 +77,7 @@ void TimeoutManager::CheckTimeouts()
 {
     std::unique_lock< std::mutex > lock( jobsMut_ );
     auto it = jobs_.begin();
-    const auto now = std::chrono::system_clock::now();
+    const auto now = Now();
     for( ; it != jobs_.end(); )
     {
         const ptime &jobSendTime = it->first;
@@ -95,7 +95,7 @@ void TimeoutManager::PushJobQueue( int64_t jobId, int queueTimeout )
     if ( queueTimeout < 0 )
         return;
 
-    const auto now = std::chrono::system_clock::now();
+    const auto now = Now();
     const auto deadlineQueue = now + std::chrono::seconds( queueTimeout );
 
     auto handlerQueue = std::make_shared< JobQueueTimeoutHandler >();
@@ -113,7 +113,7 @@ void TimeoutManager::PushJob( int64_t jobId, int jobTimeout )
     if ( jobTimeout < 0 )
         return;
 
-    const auto now = std::chrono::system_clock::now();
+    const auto now = Now();
     const auto deadline = now + std::chrono::seconds( jobTimeout );
 
     auto handler = std::make_shared< JobTimeoutHandler >();
@@ -131,7 +131,7 @@ void TimeoutManager::PushTask( const WorkerTask &task, const std::string &hostIP
     if ( timeout < 0 )
         return;
 
-    const auto now = std::chrono::system_clock::now();
+    const auto now = Now();
     const auto deadline = now + std::chrono::seconds( timeout );
 
     auto handler = std::make_shared< TaskTimeoutHandler >();
@@ -150,7 +150,7 @@ void TimeoutManager::PushCommand( CommandPtr &command, const std::string &hostIP
     if ( delay < 0 )
         return;
 
-    const auto now = std::chrono::system_clock::now();
+    const auto now = Now();
     const auto deadline = now + std::chrono::seconds( delay );
 
     auto handler = std::make_shared< StopTaskTimeoutHandler >();
@@ -46,8 +46,11 @@ struct ITimeoutManager
 
 class TimeoutManager : public ITimeoutManager
 {
-    typedef std::function< void () > Callback;
+protected:
     typedef std::chrono::system_clock::time_point ptime;
+
+private:
+    typedef std::function< void () > Callback;
     typedef std::multimap< ptime, Callback > TimeToCallback;
 
     struct TaskTimeoutHandler
@@ -92,9 +95,12 @@ public:
 
     virtual void PushCommand( CommandPtr &command, const std::string &hostIP, int delay );
 
-private:
     void CheckTimeouts();
 
+protected:
+    // simulator overrides the clock with the virtual one
+    virtual ptime Now() const { return std::chrono::system_clock::now(); }
+
 private:
     boost::asio::io_service &io_service_;
     bool stopped_;
@@ -0,0 +1,106 @@
+/*
+===========================================================================
+
+This software is licensed under the Apache 2 license, quoted below.
+
+Copyright (C) 2013 Andrey Budnik <budnik27@gmail.com>
+
+Licensed under the Apache License, Version 2.0 (the "License"); you may not
+use this file except in compliance with the License. You may obtain a copy of
+the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+License for the specific language governing permissions and limitations under
+the License.
+
+===========================================================================
+*/
+
+#ifndef __WAIT_TIME_STAT_H
+#define __WAIT_TIME_STAT_H
+
+#include <map>
+#include <vector>
+#include <ostream>
+#include <algorithm>
+#include <stdint.h> // int64_t
+
+namespace master {
+
+// Time spent by jobs in the job queue, per job priority. Only the last
+// MAX_SAMPLES wait times of each priority are kept.
+class WaitTimeStat
+{
+    struct Samples
+    {
+        Samples() : next_( 0 ) {}
+
+        std::vector< int64_t > waitTimes_;
+        size_t next_; // ring buffer position
+    };
+
+    typedef std::map< int, Samples > PriorityToSamples;
+
+public:
+    static const size_t MAX_SAMPLES = 1024;
+
+public:
+    // waitTime in milliseconds
+    void Add( int priority, int64_t waitTime )
+    {
+        Samples &samples = samples_[ priority ];
+        std::vector< int64_t > &waitTimes = samples.waitTimes_;
+        if ( waitTimes.size() < MAX_SAMPLES )
+        {
+            waitTimes.push_back( waitTime );
+        }
+        else
+        {
+            waitTimes[ samples.next_ ] = waitTime;
+            samples.next_ = ( samples.next_ + 1 ) % MAX_SAMPLES;
+        }
+    }
+
+    // percentile in range [0, 100]
+    bool GetPercentile( int priority, int percentile, int64_t &waitTime ) const
+    {
+        auto it = samples_.find( priority );
+        if ( it == samples_.end() || it->second.waitTimes_.empty() )
+            return false;
+
+        std::vector< int64_t > waitTimes( it->second.waitTimes_ );
+        const size_t n = std::min( waitTimes.size() - 1, waitTimes.size() * percentile / 100 );
+        std::nth_element( waitTimes.begin(), waitTimes.begin() + n, waitTimes.end() );
+        waitTime = waitTimes[ n ];
+        return true;
+    }
+
+    void Print( std::ostream &out ) const
+    {
+        for( const auto &it : samples_ )
+        {
+            const int priority = it.first;
+            int64_t p50, p90, p99;
+            if ( GetPercentile( priority, 50, p50 ) &&
+                 GetPercentile( priority, 90, p90 ) &&
+                 GetPercentile( priority, 99, p99 ) )
+            {
+                out << "priority " << priority << ": p50 = " << p50 <<
+                    " ms, p90 = " << p90 << " ms, p99 = " << p99 << " ms" << std::endl;
+            }
+        }
+    }
+
+    bool Empty() const { return samples_.empty(); }
+
+private:
+    PriorityToSamples samples_;
+};
+
+} // namespace master
+
+#endif
@@ -35,10 +35,8 @@ bool WorkerJob::DeleteTask( int64_t jobId, int taskId )
     if ( it != jobs_.end() )
     {
         Tasks &tasks = it->second;
-        auto it_tasks = tasks.find( taskId );
-        if ( it_tasks != tasks.end() )
+        if ( tasks.erase( taskId ) )
         {
-            tasks.erase( it_tasks );
             if ( tasks.empty() )
             {
                 jobs_.erase( it );
@@ -74,8 +72,7 @@ bool WorkerJob::HasTask( int64_t jobId, int taskId ) const
     if ( it != jobs_.end() )
     {
         const Tasks &tasks = it->second;
-        auto it_tasks = tasks.find( taskId );
-        return it_tasks != tasks.end();
+        return tasks.count( taskId ) > 0;
     }
     return false;
 }
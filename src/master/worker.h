@@ -28,6 +28,8 @@ the License.
 #include <set>
 #include <string>
 #include <memory>
+#include "common/interval_set.h"
+#include "host_ids.h"
 #include <stdint.h> // int64_t
 
 namespace master {
@@ -58,7 +60,7 @@ private:
 class WorkerJob
 {
 public:
-    typedef std::set<int> Tasks;
+    typedef common::IntervalSet Tasks;
 
 private:
     typedef std::map< int64_t, Tasks > JobIdToTasks;
@@ -109,18 +111,24 @@ class Worker
 public:
     Worker( const std::string &host, const std::string &group )
     : host_( host ), group_( group ),
+     hostId_( HostIds::INVALID_ID ),
      state_( WORKER_STATE_NOT_AVAIL ),
-     numCPU_( 0 ), numPingResponse_( 0 )
+     numCPU_( 0 ), memSizeMb_( 0 ), numPingResponse_( 0 )
     {}
 
     Worker()
-    : state_( WORKER_STATE_NOT_AVAIL ),
-     numCPU_( 0 ), numPingResponse_( 0 )
+    : hostId_( HostIds::INVALID_ID ),
+     state_( WORKER_STATE_NOT_AVAIL ),
+     numCPU_( 0 ), memSizeMb_( 0 ), numPingResponse_( 0 )
     {}
 
     void SetHost( const std::string &host ) { host_ = host; }
     void SetGroup( const std::string &group ) { group_ = group; }
-    void SetIP( const std::string &ip ) { ip_ = ip; }
+    void SetIP( const std::string &ip )
+    {
+        ip_ = ip;
+        hostId_ = HostIds::Instance().Intern( ip );
+    }
     void SetNumCPU( int numCPU ) { numCPU_ = numCPU; }
     void SetMemorySize( int64_t memSizeMb ) { memSizeMb_ = memSizeMb; }
     void SetState( WorkerState state ) { state_ = state; }
@@ -132,6 +140,7 @@ public:
     const std::string &GetHost() const { return host_; }
     const std::string &GetGroup() const { return group_; }
     const std::string &GetIP() const { return ip_; }
+    uint32_t GetHostId() const { return hostId_; }
     int GetNumCPU() const { return numCPU_; }
     int64_t GetMemorySize() const { return memSizeMb_; }
     WorkerState GetState() const { return state_; }
@@ -146,6 +155,7 @@ public:
 private:
     std::string host_, group_;
     std::string ip_;
+    uint32_t hostId_;
     WorkerState state_;
     WorkerJob job_;
     int numCPU_;
@@ -45,9 +45,7 @@ struct CompareByCPUandMemory
 
         if ( a->GetNumFreeCPU() == b->GetNumFreeCPU() )
         {
-            const WorkerPtr &wa = a->GetWorker();
-            const WorkerPtr &wb = b->GetWorker();
-            return wa && wb && ( wa->GetMemorySize() < wb->GetMemorySize() );
+            return a->GetFreeMemory() < b->GetFreeMemory();
         }
         return false;
     }
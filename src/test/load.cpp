@@ -3,6 +3,8 @@
 #include <boost/test/unit_test.hpp>
 #include <vector>
 #include <list>
+#include <chrono>
+#include <algorithm>
 #include "mock.h"
 #include "master/worker_manager.h"
 #include "master/timeout_manager.h"
@@ -84,16 +86,145 @@ BOOST_AUTO_TEST_CASE( get_task )
     WorkerJob workerJob;
     string hostIP;
     JobPtr spJob;
+
+    const auto start = std::chrono::steady_clock::now();
     while( sched.GetTaskToSend( workerJob, hostIP, spJob ) )
     {
         workerJob.Reset();
         spJob.reset();
         ++numTasksScheduled;
     }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    const int64_t elapsedMs = std::chrono::duration_cast< std::chrono::milliseconds >( elapsed ).count();
+
+    BOOST_TEST_MESSAGE( "NUM HOSTS: " << numHosts );
+    BOOST_TEST_MESSAGE( "NUM JOBS: " << numJobs );
+    BOOST_TEST_MESSAGE( "TASKS SCHEDULED: " << numTasksScheduled );
+    BOOST_TEST_MESSAGE( "PLACEMENT TIME: " << elapsedMs << " ms" );
+    BOOST_TEST_MESSAGE( "PLACEMENTS/SEC: " << ( elapsedMs ? numTasksScheduled * 1000 / elapsedMs : numTasksScheduled ) );
+}
+
+BOOST_AUTO_TEST_CASE( get_tasks_batch )
+{
+    const int numHosts = 10000;
+
+    for( int i = 0; i < numHosts; ++i )
+    {
+        workerMgr.AddWorkerHost( "grp", string( "host" ) + std::to_string( i + 1 ) );
+    }
+
+    vector< WorkerPtr > workers;
+    workerMgr.GetWorkers( workers );
+    BOOST_REQUIRE_EQUAL( workers.size(), numHosts );
+
+    for( int i = 0; i < numHosts; ++i )
+    {
+        string ip( "127.0.0." );
+        ip += std::to_string( i + 1 );
+        workerMgr.SetWorkerIP( workers[i], ip );
+
+        int numCPU = i % 4 + 1;
+        workerMgr.OnNodePingResponse( ip, numCPU, 1024 );
+    }
+
+    const int numJobs = numHosts * 10;
+
+    for( int i = 0; i < numJobs; ++i )
+    {
+        int priority = i % 10;
+        JobPtr job( new Job( "", "python", priority, 10, 1, -1, 1,
+                             1, 1, 1, false, false ) );
+        BOOST_REQUIRE( job );
+        job->SetJobId( i );
+        jobMgr.PushJob( job );
+    }
+
+    int numTasksScheduled = 0;
+    const size_t batchSize = 100;
+    TasksToSend tasks;
 
+    const auto start = std::chrono::steady_clock::now();
+    while( sched.GetTasksToSend( tasks, batchSize ) )
+    {
+        numTasksScheduled += tasks.size();
+        tasks.clear();
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    const int64_t elapsedMs = std::chrono::duration_cast< std::chrono::milliseconds >( elapsed ).count();
+
+    BOOST_TEST_MESSAGE( "BATCH SIZE: " << batchSize );
     BOOST_TEST_MESSAGE( "NUM HOSTS: " << numHosts );
     BOOST_TEST_MESSAGE( "NUM JOBS: " << numJobs );
     BOOST_TEST_MESSAGE( "TASKS SCHEDULED: " << numTasksScheduled );
+    BOOST_TEST_MESSAGE( "PLACEMENT TIME: " << elapsedMs << " ms" );
+    BOOST_TEST_MESSAGE( "PLACEMENTS/SEC: " << ( elapsedMs ? numTasksScheduled * 1000 / elapsedMs : numTasksScheduled ) );
 }
 
 BOOST_AUTO_TEST_SUITE_END()
+
+////////////////////////////////////////////////////////////////
+// Priority queues
+////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( priority_buckets )
+{
+    const int numJobs = 1000000;
+    const int numPriorities = 10;
+
+    vector< JobPtr > jobs;
+    for( int i = 0; i < numJobs; ++i )
+    {
+        JobPtr job( new Job( "", "python", ( i * 7 ) % numPriorities, 1, 1, 1, 1,
+                             1, 1, 1, false, false ) );
+        job->SetJobId( i );
+        job->SetGroupId( i );
+        jobs.push_back( job );
+    }
+
+    auto elapsedMs = []( const std::chrono::steady_clock::time_point &start ) -> int64_t
+    {
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        return std::chrono::duration_cast< std::chrono::milliseconds >( elapsed ).count();
+    };
+
+    int64_t checksum = 0;
+
+    // binary heap of jobs, ordered by priority and group id
+    auto start = std::chrono::steady_clock::now();
+    {
+        vector< JobPtr > heap;
+        for( const auto &job : jobs )
+        {
+            heap.push_back( job );
+            std::push_heap( heap.begin(), heap.end(), JobComparatorPriority() );
+        }
+        while( !heap.empty() )
+        {
+            checksum += heap.front()->GetJobId();
+            std::pop_heap( heap.begin(), heap.end(), JobComparatorPriority() );
+            heap.pop_back();
+        }
+    }
+    const int64_t heapMs = elapsedMs( start );
+
+    start = std::chrono::steady_clock::now();
+    {
+        PriorityBuckets< JobPtr > buckets;
+        for( const auto &job : jobs )
+        {
+            buckets.Push( job->GetJobId(), job->GetPriority(), job );
+        }
+        while( !buckets.Empty() )
+        {
+            checksum -= buckets.Top()->GetJobId();
+            buckets.Pop();
+        }
+    }
+    const int64_t bucketsMs = elapsedMs( start );
+
+    BOOST_CHECK_EQUAL( checksum, 0 );
+
+    BOOST_TEST_MESSAGE( "NUM JOBS: " << numJobs << ", NUM PRIORITIES: " << numPriorities );
+    BOOST_TEST_MESSAGE( "HEAP PUSH/POP TIME: " << heapMs << " ms" );
+    BOOST_TEST_MESSAGE( "PRIORITY BUCKETS PUSH/POP TIME: " << bucketsMs << " ms" );
+}
@@ -1,6 +1,7 @@
 #include "master/command.h"
 #include "master/timeout_manager.h"
 #include "master/job_history.h"
+#include "master/completion_executor.h"
 
 using namespace std;
 
@@ -28,4 +29,18 @@ struct MockJobHistory : IJobEventReceiver
     virtual void OnJobDelete( const std::string &jobName ) {}
 };
 
+struct MockCompletionExecutor : ICompletionExecutor
+{
+    virtual void Post( const Effect &effect ) { effects_.push_back( effect ); }
+
+    void RunAll()
+    {
+        for( const auto &effect : effects_ )
+            effect();
+        effects_.clear();
+    }
+
+    std::vector< Effect > effects_;
+};
+
 } // namespace master
@@ -0,0 +1,500 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE Simulation
+#include <boost/test/unit_test.hpp>
+#include <vector>
+#include <queue>
+#include <map>
+#include <random>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include "mock.h"
+#include "master/worker_manager.h"
+#include "master/timeout_manager.h"
+#include "master/job_manager.h"
+#include "master/scheduler.h"
+#include "common/service_locator.h"
+
+// Replays a recorded trace against the real Scheduler, JobManager and
+// TimeoutManager, driven by a virtual clock instead of wall time.
+//
+// Trace format, one event per line, ordered by time ('#' starts a comment):
+//   <time_ms> job <priority> <num_execution> <task_duration_ms> [task_timeout_sec]
+//   <time_ms> join <host> <num_cpu>
+//   <time_ms> fail <host>
+//
+// usage: ptest_sim --log_level=message -- <trace_file>
+// Without a trace file a synthetic one is generated.
+// Timeouts are checked once per virtual second, as TimeoutManager::Run does.
+
+using namespace std;
+using namespace master;
+
+namespace {
+
+class SimTimeoutManager : public TimeoutManager
+{
+public:
+    SimTimeoutManager( boost::asio::io_service &io_service )
+    : TimeoutManager( io_service ), now_( 0 )
+    {}
+
+    void SetTime( int64_t now ) { now_ = now; }
+
+protected:
+    virtual ptime Now() const
+    {
+        return ptime( std::chrono::milliseconds( now_ ) );
+    }
+
+private:
+    int64_t now_;
+};
+
+enum SimEventType
+{
+    SIM_EVENT_JOIN,
+    SIM_EVENT_FAIL,
+    SIM_EVENT_JOB,
+    SIM_EVENT_COMPLETION,
+    SIM_EVENT_TICK
+};
+
+struct SimEvent
+{
+    int64_t time_;
+    int64_t seq_;
+    SimEventType type_;
+
+    std::string host_;
+    int numCPU_;
+
+    int priority_;
+    int numExec_;
+    int64_t duration_;
+    int taskTimeout_;
+
+    WorkerTask workerTask_;
+};
+
+struct SimEventOrder
+{
+    bool operator() ( const SimEvent &a, const SimEvent &b ) const
+    {
+        if ( a.time_ != b.time_ )
+            return a.time_ > b.time_;
+        return a.seq_ > b.seq_;
+    }
+};
+
+struct SimJob
+{
+    SimJob() : submit_( 0 ), start_( -1 ), finish_( -1 ),
+     duration_( 0 ), numExec_( 0 ), numDone_( 0 ) {}
+
+    int64_t submit_;
+    int64_t start_;
+    int64_t finish_;
+    int64_t duration_;
+    int numExec_;
+    int numDone_;
+};
+
+typedef std::vector< SimEvent > Trace;
+
+bool ParseTrace( std::istream &in, Trace &trace )
+{
+    std::string line;
+    while( std::getline( in, line ) )
+    {
+        if ( line.empty() || line[0] == '#' )
+            continue;
+
+        std::istringstream ss( line );
+        SimEvent event = SimEvent();
+        std::string type;
+        if ( !( ss >> event.time_ >> type ) )
+            return false;
+
+        if ( type == "job" )
+        {
+            event.type_ = SIM_EVENT_JOB;
+            if ( !( ss >> event.priority_ >> event.numExec_ >> event.duration_ ) )
+                return false;
+            if ( !( ss >> event.taskTimeout_ ) )
+                event.taskTimeout_ = -1;
+        }
+        else
+        if ( type == "join" )
+        {
+            event.type_ = SIM_EVENT_JOIN;
+            if ( !( ss >> event.host_ >> event.numCPU_ ) )
+                return false;
+        }
+        else
+        if ( type == "fail" )
+        {
+            event.type_ = SIM_EVENT_FAIL;
+            if ( !( ss >> event.host_ ) )
+                return false;
+        }
+        else
+            return false;
+
+        trace.push_back( event );
+    }
+    return true;
+}
+
+void GenerateTrace( Trace &trace )
+{
+    const int numHosts = 200;
+    const int numJobs = 5000;
+    const int64_t arrivalMs = 10;
+
+    std::mt19937 gen( 1 );
+
+    for( int i = 0; i < numHosts; ++i )
+    {
+        SimEvent event = SimEvent();
+        event.type_ = SIM_EVENT_JOIN;
+        event.host_ = std::string( "host" ) + std::to_string( i + 1 );
+        event.numCPU_ = i % 4 + 1;
+        trace.push_back( event );
+    }
+
+    for( int i = 0; i < numJobs; ++i )
+    {
+        SimEvent event = SimEvent();
+        event.type_ = SIM_EVENT_JOB;
+        event.time_ = i * arrivalMs;
+        event.priority_ = gen() % 10;
+        event.numExec_ = gen() % 8 + 1;
+        event.duration_ = gen() % 1900 + 100;
+        event.taskTimeout_ = -1;
+        trace.push_back( event );
+    }
+
+    // a few nodes go down in the middle of the run and come back later
+    for( int i = 0; i < 5; ++i )
+    {
+        SimEvent event = SimEvent();
+        event.host_ = std::string( "host" ) + std::to_string( i * 10 + 1 );
+        event.numCPU_ = i * 10 % 4 + 1;
+
+        event.type_ = SIM_EVENT_FAIL;
+        event.time_ = numJobs * arrivalMs / 2 + i * 1000;
+        trace.push_back( event );
+
+        event.type_ = SIM_EVENT_JOIN;
+        event.time_ += 10000;
+        trace.push_back( event );
+    }
+}
+
+} // anonymous namespace
+
+////////////////////////////////////////////////////////////////
+// Simulator
+////////////////////////////////////////////////////////////////
+
+struct SimEnvironment
+{
+    SimEnvironment()
+    : timeoutMgr( io_service ),
+     seq_( 0 ), now_( 0 ), lastEvent_( 0 ), numLiveCPU_( 0 ),
+     busyCPUTime_( 0 ), capacityTime_( 0 ), schedClock_( 0 )
+    {
+        common::logger::InitLogger( false, "sim_test", "info" );
+
+        jobMgr.SetTimeoutManager( &timeoutMgr );
+        common::ServiceLocator &serviceLocator = common::ServiceLocator::Instance();
+        serviceLocator.Register( (master::IScheduler*)&sched );
+        serviceLocator.Register( (master::IJobManager*)&jobMgr );
+        serviceLocator.Register( (master::IWorkerManager*)&workerMgr );
+        serviceLocator.Register( (master::IJobEventReceiver*)&jobHistory );
+    }
+
+    ~SimEnvironment()
+    {
+        common::ServiceLocator::Instance().UnregisterAll();
+    }
+
+    void Push( SimEvent event )
+    {
+        event.seq_ = seq_++;
+        events_.push( event );
+    }
+
+    void Run( const Trace &trace )
+    {
+        for( const auto &event : trace )
+        {
+            Push( event );
+        }
+
+        SimEvent tick = SimEvent();
+        tick.type_ = SIM_EVENT_TICK;
+        Push( tick );
+
+        while( !events_.empty() )
+        {
+            now_ = events_.top().time_;
+            capacityTime_ += ( now_ - lastEvent_ ) * numLiveCPU_;
+            lastEvent_ = now_;
+            timeoutMgr.SetTime( now_ );
+
+            while( !events_.empty() && events_.top().time_ == now_ )
+            {
+                SimEvent event = events_.top();
+                events_.pop();
+                Apply( event );
+            }
+
+            Dispatch();
+        }
+    }
+
+    void Apply( const SimEvent &event )
+    {
+        const std::clock_t start = std::clock();
+
+        switch( event.type_ )
+        {
+            case SIM_EVENT_JOIN:
+                Join( event );
+                break;
+            case SIM_EVENT_FAIL:
+                Fail( event );
+                break;
+            case SIM_EVENT_JOB:
+                Submit( event );
+                break;
+            case SIM_EVENT_COMPLETION:
+                Complete( event );
+                break;
+            case SIM_EVENT_TICK:
+                Tick( event );
+                break;
+        }
+
+        schedClock_ += std::clock() - start;
+    }
+
+    void Join( const SimEvent &event )
+    {
+        auto it = hostToIP_.find( event.host_ );
+        if ( it == hostToIP_.end() )
+        {
+            const size_t n = hostToIP_.size() + 1;
+            const std::string ip = "10.0." + std::to_string( n / 256 ) + '.' + std::to_string( n % 256 );
+            it = hostToIP_.emplace( event.host_, ip ).first;
+
+            workerMgr.AddWorkerHost( "grp", event.host_ );
+            vector< WorkerPtr > workers;
+            workerMgr.GetWorkers( workers );
+            for( auto &w : workers )
+            {
+                if ( w->GetHost() == event.host_ )
+                    workerMgr.SetWorkerIP( w, ip );
+            }
+        }
+
+        WorkerPtr worker;
+        if ( workerMgr.GetWorkerByIP( it->second, worker ) &&
+             worker->GetState() == WORKER_STATE_NOT_AVAIL )
+        {
+            numLiveCPU_ += event.numCPU_;
+        }
+        workerMgr.OnNodePingResponse( it->second, event.numCPU_, 1024 * event.numCPU_ );
+    }
+
+    void Fail( const SimEvent &event )
+    {
+        auto it = hostToIP_.find( event.host_ );
+        WorkerPtr worker;
+        if ( it == hostToIP_.end() || !workerMgr.GetWorkerByIP( it->second, worker ) ||
+             worker->GetState() == WORKER_STATE_NOT_AVAIL )
+            return;
+
+        numLiveCPU_ -= worker->GetNumCPU();
+        worker->SetState( WORKER_STATE_NOT_AVAIL );
+        vector< WorkerPtr > workers( 1, worker );
+        sched.OnChangedWorkerState( workers );
+    }
+
+    void Submit( const SimEvent &event )
+    {
+        JobPtr job( new Job( "", "python", event.priority_, 10, event.numExec_, -1, -1,
+                             -1, -1, event.taskTimeout_, false, false ) );
+        jobMgr.PushJob( job );
+
+        SimJob &simJob = jobs_[ job->GetJobId() ];
+        simJob.submit_ = now_;
+        simJob.duration_ = event.duration_;
+        simJob.numExec_ = event.numExec_;
+    }
+
+    void Complete( const SimEvent &event )
+    {
+        // task could be already timed out or lost together with its node
+        WorkerPtr worker;
+        if ( !workerMgr.GetWorkerByIP( event.host_, worker ) ||
+             !worker->GetJob().HasTask( event.workerTask_.GetJobId(), event.workerTask_.GetTaskId() ) )
+            return;
+
+        const int64_t jobId = event.workerTask_.GetJobId();
+        sched.OnTaskCompletion( 0, event.duration_, event.workerTask_, event.host_ );
+
+        busyCPUTime_ += event.duration_;
+        SimJob &simJob = jobs_[ jobId ];
+        if ( ++simJob.numDone_ == simJob.numExec_ )
+            simJob.finish_ = now_;
+    }
+
+    void Tick( SimEvent event )
+    {
+        timeoutMgr.CheckTimeouts();
+
+        // keep ticking while anything else is left to replay
+        if ( !events_.empty() )
+        {
+            event.time_ += 1000;
+            Push( event );
+        }
+    }
+
+    void Dispatch()
+    {
+        TasksToSend tasks;
+        while( true )
+        {
+            const size_t numJobs = sched.GetScheduledJobs().GetNumJobs();
+
+            const std::clock_t start = std::clock();
+            const bool found = sched.GetTasksToSend( tasks, 1000 );
+            schedClock_ += std::clock() - start;
+
+            if ( !found )
+            {
+                // scheduler could pull new jobs from the queue instead of placing
+                if ( sched.GetScheduledJobs().GetNumJobs() == numJobs )
+                    break;
+                continue;
+            }
+
+            for( const auto &task : tasks )
+            {
+                const WorkerJob &workerJob = task.workerJob_;
+                const int64_t jobId = workerJob.GetJobId();
+                SimJob &simJob = jobs_[ jobId ];
+                if ( simJob.start_ < 0 )
+                    simJob.start_ = now_;
+
+                WorkerJob::Tasks taskIds;
+                workerJob.GetTasks( jobId, taskIds );
+                for( int taskId : taskIds )
+                {
+                    SimEvent event = SimEvent();
+                    event.type_ = SIM_EVENT_COMPLETION;
+                    event.time_ = now_ + simJob.duration_;
+                    event.duration_ = simJob.duration_;
+                    event.host_ = task.hostIP_;
+                    event.workerTask_ = WorkerTask( jobId, taskId );
+                    Push( event );
+
+                    timeoutMgr.PushTask( event.workerTask_, task.hostIP_, task.job_->GetTaskTimeout() );
+                }
+            }
+            tasks.clear();
+        }
+    }
+
+    void Report()
+    {
+        vector< int64_t > waits;
+        int64_t makespan = 0;
+        int numCompleted = 0;
+        for( const auto &it : jobs_ )
+        {
+            const SimJob &simJob = it.second;
+            if ( simJob.start_ >= 0 )
+                waits.push_back( simJob.start_ - simJob.submit_ );
+            if ( simJob.finish_ >= 0 )
+            {
+                ++numCompleted;
+                makespan = std::max( makespan, simJob.finish_ );
+            }
+        }
+        std::sort( waits.begin(), waits.end() );
+
+        auto percentile = [&waits]( int p ) -> int64_t
+        {
+            if ( waits.empty() )
+                return 0;
+            return waits[ ( waits.size() - 1 ) * p / 100 ];
+        };
+
+        const int64_t utilization = capacityTime_ ? busyCPUTime_ * 100 / capacityTime_ : 0;
+        const int64_t schedMs = schedClock_ * 1000 / CLOCKS_PER_SEC;
+
+        BOOST_TEST_MESSAGE( "NUM JOBS: " << jobs_.size() );
+        BOOST_TEST_MESSAGE( "JOBS COMPLETED: " << numCompleted );
+        BOOST_TEST_MESSAGE( "MAKESPAN: " << makespan << " ms" );
+        BOOST_TEST_MESSAGE( "UTILIZATION: " << utilization << " %" );
+        BOOST_TEST_MESSAGE( "QUEUE WAIT P50: " << percentile( 50 ) << " ms" );
+        BOOST_TEST_MESSAGE( "QUEUE WAIT P99: " << percentile( 99 ) << " ms" );
+        BOOST_TEST_MESSAGE( "SCHEDULING CPU TIME: " << schedMs << " ms" );
+    }
+
+    boost::asio::io_service io_service;
+    SimTimeoutManager timeoutMgr;
+    MockJobHistory jobHistory;
+    JobManager jobMgr;
+    WorkerManager workerMgr;
+    Scheduler sched;
+
+    std::priority_queue< SimEvent, std::vector< SimEvent >, SimEventOrder > events_;
+    std::map< std::string, std::string > hostToIP_;
+    std::map< int64_t, SimJob > jobs_;
+    int64_t seq_;
+    int64_t now_, lastEvent_;
+    int64_t numLiveCPU_;
+    int64_t busyCPUTime_, capacityTime_;
+    std::clock_t schedClock_;
+};
+
+BOOST_FIXTURE_TEST_SUITE( SimSuite, SimEnvironment )
+
+BOOST_AUTO_TEST_CASE( replay_trace )
+{
+    Trace trace;
+
+    auto &suite = boost::unit_test::framework::master_test_suite();
+    if ( suite.argc > 1 )
+    {
+        std::ifstream file( suite.argv[1] );
+        BOOST_REQUIRE( file.is_open() );
+        BOOST_REQUIRE( ParseTrace( file, trace ) );
+    }
+    else
+    {
+        GenerateTrace( trace );
+    }
+
+    Run( trace );
+    Report();
+
+    // recorded traces may contain jobs failing by design
+    if ( suite.argc <= 1 )
+    {
+        for( const auto &it : jobs_ )
+        {
+            BOOST_CHECK( it.second.finish_ >= 0 );
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
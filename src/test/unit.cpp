@@ -3,13 +3,18 @@
 #include <boost/test/unit_test.hpp>
 #include <vector>
 #include <list>
+#include <thread>
+#include <chrono>
 #include "mock.h"
 #include "master/worker_manager.h"
 #include "master/timeout_manager.h"
 #include "master/job_manager.h"
 #include "master/scheduler.h"
+#include "master/fair_share.h"
 #include "common/service_locator.h"
 #include "common/cron.h"
+#include "common/interval_set.h"
+#include "common/protocol.h"
 
 using namespace std;
 using namespace master;
@@ -19,3 +24,4 @@ using namespace master;
 #include "unit_scheduler.h"
 #include "unit_scheduled_jobs.h"
 #include "unit_cron.h"
+#include "unit_interval_set.h"
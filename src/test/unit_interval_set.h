@@ -0,0 +1,59 @@
+////////////////////////////////////////////////////////////////
+// Interval set
+////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( interval_set_insert_erase )
+{
+    common::IntervalSet s;
+    BOOST_CHECK( s.empty() );
+
+    s.insert( 0, 999 );
+    BOOST_CHECK_EQUAL( s.size(), 1000 );
+    BOOST_CHECK_EQUAL( s.GetIntervals().size(), 1 );
+    BOOST_CHECK( s.insert( 1000 ) );
+    BOOST_CHECK( !s.insert( 500 ) );
+    BOOST_CHECK_EQUAL( s.GetIntervals().size(), 1 );
+
+    BOOST_CHECK_EQUAL( s.erase( 500 ), 1 );
+    BOOST_CHECK_EQUAL( s.erase( 500 ), 0 );
+    BOOST_CHECK_EQUAL( s.count( 500 ), 0 );
+    BOOST_CHECK_EQUAL( s.count( 501 ), 1 );
+    BOOST_CHECK_EQUAL( s.size(), 1000 );
+    BOOST_CHECK_EQUAL( s.GetIntervals().size(), 2 );
+
+    s.insert( 2000, 2010 );
+    s.insert( 400, 2005 );
+    BOOST_CHECK_EQUAL( s.size(), 2011 );
+    BOOST_CHECK_EQUAL( s.GetIntervals().size(), 1 );
+
+    int expected = 0;
+    for( auto v : s )
+    {
+        BOOST_CHECK_EQUAL( v, expected++ );
+    }
+    BOOST_CHECK_EQUAL( expected, 2011 );
+
+    while( !s.empty() )
+    {
+        s.erase( *s.begin() );
+    }
+    BOOST_CHECK_EQUAL( s.size(), 0 );
+}
+
+BOOST_AUTO_TEST_CASE( interval_set_marshalling )
+{
+    common::IntervalSet s, out;
+    s.insert( 0, 9 );
+    s.insert( 20 );
+    s.insert( 30, 31 );
+
+    common::Marshaller marshaller;
+    marshaller( "tasks", s );
+
+    common::Demarshaller demarshaller;
+    demarshaller.GetProperties() = marshaller.GetProperties();
+    demarshaller( "tasks", out );
+
+    BOOST_CHECK( out.GetIntervals() == s.GetIntervals() );
+    BOOST_CHECK_EQUAL( out.size(), 13 );
+}
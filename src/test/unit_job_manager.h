@@ -302,6 +302,105 @@ BOOST_AUTO_TEST_CASE( job_priority )
     }
 }
 
+BOOST_AUTO_TEST_CASE( job_priority_delete )
+{
+    const int numJobs = 100;
+
+    vector< JobPtr > jobs;
+    for( int i = 0; i < numJobs; ++i )
+    {
+        int priority = ( i * 7 ) % 10;
+        JobPtr job( new Job( "", "python", priority, 1, 1, 1, 1,
+                             1, 1, 1, false, false ) );
+        BOOST_REQUIRE( job );
+        mgr.PushJob( job );
+        jobs.push_back( job );
+    }
+
+    // deletion from the middle of the queue keeps the priority order
+    for( int i = 0; i < numJobs; i += 3 )
+    {
+        BOOST_CHECK( mgr.DeleteJob( jobs[i]->GetJobId() ) );
+    }
+    BOOST_CHECK_EQUAL( mgr.DeleteJob( jobs[0]->GetJobId() ), false );
+
+    int lastPriority = -1;
+    int numPopped = 0;
+    JobPtr j;
+    while( mgr.PopJob( j ) )
+    {
+        BOOST_CHECK_GE( j->GetPriority(), lastPriority );
+        BOOST_CHECK( j->GetJobId() % 3 != jobs[0]->GetJobId() % 3 );
+        lastPriority = j->GetPriority();
+        ++numPopped;
+    }
+    BOOST_CHECK_EQUAL( numPopped, numJobs - ( numJobs + 2 ) / 3 );
+}
+
+BOOST_AUTO_TEST_CASE( job_priority_aging )
+{
+    // effective priority rises by one level every 10 ms
+    mgr.SetPriorityAging( 10 );
+
+    JobPtr lowPriorityJob( new Job( "", "python", 5, 1, 1, 1, 1,
+                                    1, 1, 1, false, false ) );
+    mgr.PushJob( lowPriorityJob );
+
+    std::this_thread::sleep_for( std::chrono::milliseconds( 100 ) );
+
+    JobPtr highPriorityJob( new Job( "", "python", 0, 1, 1, 1, 1,
+                                     1, 1, 1, false, false ) );
+    mgr.PushJob( highPriorityJob );
+
+    JobPtr j;
+    BOOST_REQUIRE( mgr.PopJob( j ) );
+    BOOST_CHECK_EQUAL( j->GetPriority(), 5 );
+    BOOST_REQUIRE( mgr.PopJob( j ) );
+    BOOST_CHECK_EQUAL( j->GetPriority(), 0 );
+
+    WaitTimeStat stat;
+    mgr.GetWaitTimeStat( stat );
+    int64_t waitTime;
+    BOOST_REQUIRE( stat.GetPercentile( 5, 50, waitTime ) );
+    BOOST_CHECK_GE( waitTime, 100 );
+    BOOST_REQUIRE( stat.GetPercentile( 0, 99, waitTime ) );
+    BOOST_CHECK_EQUAL( stat.GetPercentile( 1, 50, waitTime ), false );
+}
+
+BOOST_AUTO_TEST_CASE( job_fair_share )
+{
+    FairShare &fairShare = FairShare::Instance();
+    fairShare.SetEnabled( true );
+    fairShare.SetCapacity( 4, 1024 );
+
+    const char *queues[] = { "a", "b", "c" };
+    for( int i = 0; i < 3; ++i )
+    {
+        // the most prioritized jobs are in the most served queue
+        JobPtr job( new Job( "", "python", i, 1, 1, 1, 1,
+                             1, 1, 1, false, false ) );
+        job->SetQueue( queues[i] );
+        mgr.PushJob( job );
+    }
+
+    fairShare.SetWeight( "b", 2 );
+    fairShare.AddUsage( "a", 4, 0, 3000 );
+    fairShare.AddUsage( "b", 4, 0, 4000 );
+    fairShare.AddUsage( "c", 1, 1024, 2500 );
+
+    // shares: a = 3000, b = 4000 / 2, c = max( 625, 2500 )
+    const char *expected[] = { "b", "c", "a" };
+    for( int i = 0; i < 3; ++i )
+    {
+        JobPtr j;
+        BOOST_REQUIRE( mgr.PopJob( j ) );
+        BOOST_CHECK_EQUAL( j->GetQueue(), expected[i] );
+    }
+
+    fairShare.SetEnabled( false );
+    fairShare.Clear();
+}
+
 BOOST_AUTO_TEST_CASE( test_job_name_registry )
 {
     std::string jobName1 = "jobName1";
@@ -113,17 +113,16 @@ BOOST_AUTO_TEST_CASE( jobs_priority )
             int priority = i % 10;
             JobPtr job( new Job( "", "python", priority, 1, 1, 1, 1,
                                  1, 1, 1, false, false ) );
+            job->SetJobId( k * numJobs + i );
             job->SetGroupId( k );
             Add( job, i + 1 );
         }
     }
 
-    auto it = GetJobQueueBegin();
-
     int lastPriority, lastGroupId;
-    for( int i = 0; it != GetJobQueueEnd(); ++it, ++i )
+    int i = 0;
+    ForEachJob( [&]( const JobState &jobState )
     {
-        const JobState &jobState = it->first;
         const JobPtr &j = jobState.GetJob();
 
         if ( i )
@@ -134,7 +133,46 @@ BOOST_AUTO_TEST_CASE( jobs_priority )
         }
         lastPriority = j->GetPriority();
         lastGroupId = j->GetGroupId();
+        ++i;
+    } );
+    BOOST_CHECK_EQUAL( i, numGroups * numJobs );
+}
+
+BOOST_AUTO_TEST_CASE( jobs_priority_buckets )
+{
+    PriorityBuckets< int > buckets;
+    BOOST_CHECK( buckets.Empty() );
+
+    // priorities out of the bitmap range go to the overflow buckets
+    const int priorities[] = { 5, 100, 0, -3, 5, 63, 64, 0 };
+    for( int i = 0; i < 8; ++i )
+    {
+        BOOST_CHECK( buckets.Push( i, priorities[i], priorities[i] * 1000 + i ) );
+    }
+    BOOST_CHECK_EQUAL( buckets.Push( 0, 1, 1 ), false );
+    BOOST_CHECK_EQUAL( buckets.Size(), 8 );
+
+    BOOST_CHECK( buckets.Erase( 6 ) );
+    BOOST_CHECK_EQUAL( buckets.Erase( 6 ), false );
+    BOOST_CHECK( buckets.Find( 6 ) == nullptr );
+    BOOST_REQUIRE( buckets.Find( 1 ) != nullptr );
+    BOOST_CHECK_EQUAL( *buckets.Find( 1 ), 100001 );
+
+    // priority order, FIFO within the same priority
+    const int expected[] = { -2997, 2, 7, 5000, 5004, 63005, 100001 };
+    int i = 0;
+    buckets.ForEach( [&]( int value )
+    {
+        BOOST_CHECK_EQUAL( value, expected[ i++ ] );
+    } );
+    BOOST_CHECK_EQUAL( i, 7 );
+
+    for( i = 0; !buckets.Empty(); ++i )
+    {
+        BOOST_CHECK_EQUAL( buckets.Top(), expected[i] );
+        buckets.Pop();
     }
+    BOOST_CHECK_EQUAL( i, 7 );
 }
 
 BOOST_AUTO_TEST_CASE( jobs_named )
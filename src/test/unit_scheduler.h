@@ -185,6 +185,253 @@ BOOST_AUTO_TEST_CASE( get_task_to_send_multiple )
     }
 }
 
+BOOST_AUTO_TEST_CASE( get_tasks_to_send_batch )
+{
+    workerMgr.AddWorkerHost( "grp", "host1" );
+    workerMgr.AddWorkerHost( "grp", "host2" );
+
+    vector< WorkerPtr > workers;
+    workerMgr.GetWorkers( workers );
+    BOOST_REQUIRE_EQUAL( workers.size(), 2 );
+
+    const int numJobs = 5;
+
+    workerMgr.SetWorkerIP( workers[0], "127.0.0.1" );
+    workerMgr.OnNodePingResponse( "127.0.0.1", numJobs, 1024 );
+    workerMgr.SetWorkerIP( workers[1], "127.0.0.2" );
+    workerMgr.OnNodePingResponse( "127.0.0.2", 1, 1024 );
+
+    for( int i = 0; i < numJobs; ++i )
+    {
+        JobPtr job( jobMgr.CreateJob(
+                      "{\"script\" : \"simple.py\","
+                      "\"language\" : \"python\","
+                      "\"send_script\" : false,"
+                      "\"priority\" : 4,"
+                      "\"job_timeout\" : 120,"
+                      "\"queue_timeout\" : 60,"
+                      "\"task_timeout\" : 15,"
+                      "\"max_failed_nodes\" : 10,"
+                      "\"num_execution\" : 1,"
+                      "\"max_cluster_instances\" : -1,"
+                      "\"max_worker_instances\" : 1,"
+                      "\"exclusive\" : false,"
+                      "\"no_reschedule\" : false}", true ) );
+        BOOST_REQUIRE( job );
+        jobMgr.PushJob( job );
+    }
+
+    TasksToSend tasks;
+    BOOST_CHECK( sched.GetTasksToSend( tasks, 2 ) );
+    BOOST_CHECK_EQUAL( tasks.size(), 2 );
+
+    BOOST_CHECK( sched.GetTasksToSend( tasks, numJobs ) );
+    BOOST_CHECK_EQUAL( tasks.size(), numJobs ); // batch is appended to the tasks
+
+    std::set< int64_t > jobs;
+    for( const auto &task : tasks )
+    {
+        BOOST_CHECK( (bool)task.job_ );
+        BOOST_CHECK_EQUAL( task.workerJob_.GetTotalNumTasks(), 1 );
+        jobs.insert( task.workerJob_.GetJobId() );
+    }
+    BOOST_CHECK_EQUAL( jobs.size(), numJobs );
+
+    tasks.clear();
+    BOOST_CHECK_EQUAL( sched.GetTasksToSend( tasks, numJobs ), false );
+    BOOST_CHECK( tasks.empty() );
+}
+
+BOOST_AUTO_TEST_CASE( placement_spread )
+{
+    sched.SetPlacementPolicy( PlacementPolicy::SPREAD );
+
+    workerMgr.AddWorkerHost( "grp", "host1" );
+    workerMgr.AddWorkerHost( "grp", "host2" );
+
+    vector< WorkerPtr > workers;
+    workerMgr.GetWorkers( workers );
+    BOOST_REQUIRE_EQUAL( workers.size(), 2 );
+
+    workerMgr.SetWorkerIP( workers[0], "127.0.0.1" );
+    workerMgr.OnNodePingResponse( "127.0.0.1", 8, 1024 );
+    workerMgr.SetWorkerIP( workers[1], "127.0.0.2" );
+    workerMgr.OnNodePingResponse( "127.0.0.2", 2, 1024 );
+
+    const int numJobs = 3;
+    for( int i = 0; i < numJobs; ++i )
+    {
+        JobPtr job( jobMgr.CreateJob(
+                      "{\"script\" : \"simple.py\","
+                      "\"language\" : \"python\","
+                      "\"send_script\" : false,"
+                      "\"priority\" : 4,"
+                      "\"job_timeout\" : 120,"
+                      "\"queue_timeout\" : 60,"
+                      "\"task_timeout\" : 15,"
+                      "\"max_failed_nodes\" : 10,"
+                      "\"num_execution\" : 1,"
+                      "\"max_cluster_instances\" : -1,"
+                      "\"max_worker_instances\" : 1,"
+                      "\"exclusive\" : false,"
+                      "\"no_reschedule\" : false}", true ) );
+        BOOST_REQUIRE( job );
+        jobMgr.PushJob( job );
+    }
+
+    // the most free node first
+    WorkerJob workerJob;
+    string hostIP;
+    JobPtr spJob;
+    BOOST_REQUIRE( sched.GetTaskToSend( workerJob, hostIP, spJob ) );
+    BOOST_CHECK_EQUAL( hostIP, "127.0.0.1" );
+
+    TasksToSend tasks;
+    BOOST_CHECK( sched.GetTasksToSend( tasks, numJobs ) );
+    BOOST_CHECK_EQUAL( tasks.size(), numJobs - 1 );
+    for( const auto &task : tasks )
+    {
+        BOOST_CHECK_EQUAL( task.hostIP_, "127.0.0.1" );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( placement_pack )
+{
+    sched.SetPlacementPolicy( PlacementPolicy::PACK );
+
+    workerMgr.AddWorkerHost( "grp", "host1" );
+    workerMgr.AddWorkerHost( "grp", "host2" );
+
+    vector< WorkerPtr > workers;
+    workerMgr.GetWorkers( workers );
+    BOOST_REQUIRE_EQUAL( workers.size(), 2 );
+
+    workerMgr.SetWorkerIP( workers[0], "127.0.0.1" );
+    workerMgr.OnNodePingResponse( "127.0.0.1", 4, 1024 );
+    workerMgr.SetWorkerIP( workers[1], "127.0.0.2" );
+    workerMgr.OnNodePingResponse( "127.0.0.2", 2, 1024 );
+
+    const int numJobs = 3;
+    for( int i = 0; i < numJobs; ++i )
+    {
+        JobPtr job( jobMgr.CreateJob(
+                      "{\"script\" : \"simple.py\","
+                      "\"language\" : \"python\","
+                      "\"send_script\" : false,"
+                      "\"priority\" : 4,"
+                      "\"job_timeout\" : 120,"
+                      "\"queue_timeout\" : 60,"
+                      "\"task_timeout\" : 15,"
+                      "\"max_failed_nodes\" : 10,"
+                      "\"num_execution\" : 1,"
+                      "\"max_cluster_instances\" : -1,"
+                      "\"max_worker_instances\" : 1,"
+                      "\"exclusive\" : false,"
+                      "\"no_reschedule\" : false}", true ) );
+        BOOST_REQUIRE( job );
+        jobMgr.PushJob( job );
+    }
+
+    // the least free node first, until it is filled up
+    TasksToSend tasks;
+    BOOST_CHECK( sched.GetTasksToSend( tasks, numJobs ) );
+    BOOST_REQUIRE_EQUAL( tasks.size(), numJobs );
+    BOOST_CHECK_EQUAL( tasks[0].hostIP_, "127.0.0.2" );
+    BOOST_CHECK_EQUAL( tasks[1].hostIP_, "127.0.0.2" );
+    BOOST_CHECK_EQUAL( tasks[2].hostIP_, "127.0.0.1" );
+}
+
+BOOST_AUTO_TEST_CASE( placement_power_of_two )
+{
+    sched.SetPlacementPolicy( PlacementPolicy::POWER_OF_TWO );
+
+    workerMgr.AddWorkerHost( "grp", "host1" );
+    workerMgr.AddWorkerHost( "grp", "host2" );
+
+    vector< WorkerPtr > workers;
+    workerMgr.GetWorkers( workers );
+    BOOST_REQUIRE_EQUAL( workers.size(), 2 );
+
+    workerMgr.SetWorkerIP( workers[0], "127.0.0.1" );
+    workerMgr.OnNodePingResponse( "127.0.0.1", 4, 1024 );
+    workerMgr.SetWorkerIP( workers[1], "127.0.0.2" );
+    workerMgr.OnNodePingResponse( "127.0.0.2", 2, 1024 );
+
+    const int numJobs = 3;
+    for( int i = 0; i < numJobs; ++i )
+    {
+        JobPtr job( jobMgr.CreateJob(
+                      "{\"script\" : \"simple.py\","
+                      "\"language\" : \"python\","
+                      "\"send_script\" : false,"
+                      "\"priority\" : 4,"
+                      "\"job_timeout\" : 120,"
+                      "\"queue_timeout\" : 60,"
+                      "\"task_timeout\" : 15,"
+                      "\"max_failed_nodes\" : 10,"
+                      "\"num_execution\" : 1,"
+                      "\"max_cluster_instances\" : -1,"
+                      "\"max_worker_instances\" : 1,"
+                      "\"exclusive\" : false,"
+                      "\"no_reschedule\" : false}", true ) );
+        BOOST_REQUIRE( job );
+        jobMgr.PushJob( job );
+    }
+
+    TasksToSend tasks;
+    BOOST_CHECK( sched.GetTasksToSend( tasks, numJobs ) );
+    BOOST_CHECK_EQUAL( tasks.size(), numJobs );
+
+    int numFreeCPU = 0;
+    const Scheduler::IPToNodeState &ipToNodeState = sched.GetNodeState();
+    for( const auto &it : ipToNodeState )
+    {
+        numFreeCPU += it.second.GetNumFreeCPU();
+    }
+    BOOST_CHECK_EQUAL( numFreeCPU, 4 + 2 - numJobs );
+
+    tasks.clear();
+    BOOST_CHECK_EQUAL( sched.GetTasksToSend( tasks, numJobs ), false );
+}
+
+BOOST_AUTO_TEST_CASE( node_index )
+{
+    const int numNodes = 200;
+    vector< NodeState > nodes( numNodes );
+    NodeIndex index;
+    for( int i = 0; i < numNodes; ++i )
+    {
+        WorkerPtr worker( new Worker );
+        worker->SetNumCPU( i % 100 + 1 );
+        nodes[i].SetWorker( worker );
+        index.Update( &nodes[i] );
+    }
+    BOOST_CHECK_EQUAL( index.Size(), numNodes );
+    BOOST_CHECK_EQUAL( index.GetMaxFreeCPU(), 100 );
+    BOOST_CHECK_EQUAL( index.GetNextBucket( 0 ), 1 );
+    BOOST_CHECK_EQUAL( index.GetNextBucket( 63 ), 64 );
+    BOOST_CHECK_EQUAL( index.GetPrevBucket( 65 ), 64 );
+
+    // busy nodes move to the bucket of their free CPU count
+    nodes[99].AllocCPU( 100 );
+    index.Update( &nodes[99] );
+    nodes[199].AllocCPU( 30 );
+    index.Update( &nodes[199] );
+    BOOST_CHECK_EQUAL( index.GetMaxFreeCPU(), 99 );
+    BOOST_CHECK_EQUAL( index.GetFirst( 70 ), &nodes[69] );
+    BOOST_CHECK_EQUAL( NodeIndex::GetNext( &nodes[69] ), &nodes[169] );
+    BOOST_CHECK_EQUAL( NodeIndex::GetNext( &nodes[169] ), &nodes[199] );
+    BOOST_CHECK_EQUAL( index.GetFirst( 0 ), &nodes[99] );
+
+    index.Erase( &nodes[69] );
+    index.Erase( &nodes[169] );
+    index.Erase( &nodes[199] );
+    BOOST_CHECK_EQUAL( index.Size(), numNodes - 3 );
+    BOOST_CHECK( index.GetFirst( 70 ) == nullptr );
+    BOOST_CHECK_EQUAL( index.GetNextBucket( 69 ), 71 );
+    BOOST_CHECK_EQUAL( index.GetPrevBucket( 71 ), 69 );
+}
+
 BOOST_AUTO_TEST_CASE( task_send_completion )
 {
     workerMgr.AddWorkerHost( "grp", "host1" );
@@ -273,7 +520,7 @@ BOOST_AUTO_TEST_CASE( task_completion_failure )
     sched.OnTaskCompletion( -1, 10, tasks[0], hostIP ); // -1 means error
     const FailedWorkers &failed = sched.GetFailedWorkers();
     BOOST_CHECK_EQUAL( failed.GetFailedJobsCnt(), 1 );
-    BOOST_CHECK_EQUAL( sched.GetNeedReschedule().size(), 1 );
+    BOOST_CHECK_EQUAL( sched.GetNumNeedReschedule(), 1 );
 }
 
 BOOST_AUTO_TEST_CASE( task_completion )
@@ -874,7 +1121,7 @@ BOOST_AUTO_TEST_CASE( task_completion_max_worker_instances )
     BOOST_CHECK_EQUAL( tasks.size(), maxCPU );
 }
 
-BOOST_AUTO_TEST_CASE( task_completion_max_exec_at_worker )
+BOOST_AUTO_TEST_CASE( task_memory_limit )
 {
     workerMgr.AddWorkerHost( "grp", "host1" );
 
@@ -882,10 +1129,8 @@ BOOST_AUTO_TEST_CASE( task_completion_max_exec_at_worker )
     workerMgr.GetWorkers( workers );
     BOOST_REQUIRE_EQUAL( workers.size(), 1 );
 
-    const int numCPU = 8;
-
     workerMgr.SetWorkerIP( workers[0], "127.0.0.1" );
-    workerMgr.OnNodePingResponse( "127.0.0.1", numCPU, 1024 );
+    workerMgr.OnNodePingResponse( "127.0.0.1", 4, 1024 );
 
     JobPtr job( jobMgr.CreateJob(
                   "{\"script\" : \"simple.py\","
@@ -896,32 +1141,50 @@ BOOST_AUTO_TEST_CASE( task_completion_max_exec_at_worker )
                   "\"queue_timeout\" : 60,"
                   "\"task_timeout\" : 15,"
                   "\"max_failed_nodes\" : 10,"
-                  "\"num_execution\" : 5,"
+                  "\"num_execution\" : 4,"
                   "\"max_cluster_instances\" : -1,"
-                  "\"max_worker_instances\" : 4,"
+                  "\"max_worker_instances\" : -1,"
                   "\"exclusive\" : false,"
                   "\"no_reschedule\" : false,"
-                  "\"max_exec_at_worker\" : 4}", true ) );
+                  "\"task_memory\" : 400}", true ) );
     BOOST_REQUIRE( job );
+    BOOST_CHECK_EQUAL( job->GetTaskMemory(), 400 );
     jobMgr.PushJob( job );
 
-    const int maxExecAtWorker = 4;
-    BOOST_REQUIRE_GT( numCPU, maxExecAtWorker );
-
     WorkerJob workerJob;
     string hostIP;
     JobPtr spJob;
 
-    BOOST_CHECK( sched.GetTaskToSend( workerJob, hostIP, spJob ) );
-    BOOST_CHECK( (bool)spJob );
+    BOOST_REQUIRE( sched.GetTaskToSend( workerJob, hostIP, spJob ) );
+    BOOST_CHECK_EQUAL( workerJob.GetTotalNumTasks(), 2 );
+
+    const Scheduler::IPToNodeState &ipToNodeState = sched.GetNodeState();
+    auto it = ipToNodeState.find( "127.0.0.1" );
+    BOOST_REQUIRE( it != ipToNodeState.end() );
+    const NodeState &nodeState = it->second;
+    BOOST_CHECK_EQUAL( nodeState.GetFreeMemory(), 1024 - 2 * 400 );
+    BOOST_CHECK_EQUAL( nodeState.GetNumFreeCPU(), 2 );
+
+    // free cpu's left, but not enough memory
+    {
+        WorkerJob workerJob;
+        BOOST_CHECK( !sched.GetTaskToSend( workerJob, hostIP, spJob ) );
+    }
 
     vector< WorkerTask > tasks;
     workerJob.GetTasks( tasks );
-    BOOST_CHECK_EQUAL( tasks.size(), maxExecAtWorker );
+    sched.OnTaskCompletion( 0, 10, tasks[0], hostIP );
+    BOOST_CHECK_EQUAL( nodeState.GetFreeMemory(), 1024 - 400 );
+
+    workerJob.Reset();
+    BOOST_REQUIRE( sched.GetTaskToSend( workerJob, hostIP, spJob ) );
+    BOOST_CHECK_EQUAL( workerJob.GetTotalNumTasks(), 1 );
 }
 
-BOOST_AUTO_TEST_CASE( task_completion_exclusive ) // 1st job - exclusive, 2nd job - not exclusive
+BOOST_AUTO_TEST_CASE( backfill_exclusive )
 {
+    sched.SetBackfill( true );
+
     workerMgr.AddWorkerHost( "grp", "host1" );
 
     vector< WorkerPtr > workers;
@@ -931,63 +1194,67 @@ BOOST_AUTO_TEST_CASE( task_completion_exclusive ) // 1st job - exclusive, 2nd jo
     workerMgr.SetWorkerIP( workers[0], "127.0.0.1" );
     workerMgr.OnNodePingResponse( "127.0.0.1", 2, 1024 );
 
-    JobPtr job( jobMgr.CreateJob(
-                  "{\"script\" : \"simple.py\","
-                  "\"language\" : \"python\","
-                  "\"send_script\" : false,"
-                  "\"priority\" : 4,"
-                  "\"job_timeout\" : 120,"
-                  "\"queue_timeout\" : 60,"
-                  "\"task_timeout\" : 15,"
-                  "\"max_failed_nodes\" : 10,"
-                  "\"num_execution\" : 1,"
-                  "\"max_cluster_instances\" : -1,"
-                  "\"max_worker_instances\" : 1,"
-                  "\"exclusive\" : true,"
-                  "\"no_reschedule\" : false}", true ) );
-    BOOST_REQUIRE( job );
-    jobMgr.PushJob( job );
+    auto createJob = [this]( int priority, int taskTimeout, bool exclusive ) -> JobPtr
+    {
+        std::ostringstream ss;
+        ss << "{\"script\" : \"simple.py\","
+            "\"language\" : \"python\","
+            "\"send_script\" : false,"
+            "\"priority\" : " << priority << ","
+            "\"job_timeout\" : 120,"
+            "\"queue_timeout\" : 60,"
+            "\"task_timeout\" : " << taskTimeout << ","
+            "\"max_failed_nodes\" : 10,"
+            "\"num_execution\" : 1,"
+            "\"max_cluster_instances\" : -1,"
+            "\"max_worker_instances\" : -1,"
+            "\"exclusive\" : " << ( exclusive ? "true" : "false" ) << ","
+            "\"no_reschedule\" : false}";
+        JobPtr job( jobMgr.CreateJob( ss.str(), true ) );
+        BOOST_REQUIRE( job );
+        jobMgr.PushJob( job );
+        return job;
+    };
 
     WorkerJob workerJob;
     string hostIP;
     JobPtr spJob;
 
-    BOOST_CHECK( sched.GetTaskToSend( workerJob, hostIP, spJob ) );
-    BOOST_CHECK( (bool)spJob );
+    // running task drains the node in 15 seconds
+    JobPtr running = createJob( 4, 15, false );
+    BOOST_REQUIRE( sched.GetTaskToSend( workerJob, hostIP, spJob ) );
+    BOOST_CHECK_EQUAL( spJob, running );
 
-    job.reset( jobMgr.CreateJob(
-                  "{\"script\" : \"simple.py\","
-                  "\"language\" : \"python\","
-                  "\"send_script\" : false,"
-                  "\"priority\" : 4,"
-                  "\"job_timeout\" : 120,"
-                  "\"queue_timeout\" : 60,"
-                  "\"task_timeout\" : 15,"
-                  "\"max_failed_nodes\" : 10,"
-                  "\"num_execution\" : 1,"
-                  "\"max_cluster_instances\" : -1,"
-                  "\"max_worker_instances\" : 1,"
-                  "\"exclusive\" : false,"
-                  "\"no_reschedule\" : false}", true ) );
-    BOOST_REQUIRE( job );
-    jobMgr.PushJob( job );
+    JobPtr exclusive = createJob( 0, 15, true );
+    JobPtr longJob = createJob( 8, 60, false );
+    JobPtr shortJob = createJob( 8, 5, false );
 
+    // only the short task fits before the reservation of the exclusive job
     workerJob.Reset();
-    spJob.reset();
+    BOOST_REQUIRE( sched.GetTaskToSend( workerJob, hostIP, spJob ) );
+    BOOST_CHECK_EQUAL( spJob, shortJob );
 
-    BOOST_CHECK_EQUAL( sched.GetTaskToSend( workerJob, hostIP, spJob ), false );
+    workerJob.Reset();
+    BOOST_CHECK( !sched.GetTaskToSend( workerJob, hostIP, spJob ) );
 }
 
-BOOST_AUTO_TEST_CASE( task_completion_exclusive2 ) // 1st job - not exclusive, 2nd job - exclusive
+BOOST_AUTO_TEST_CASE( speculative_execution )
 {
+    sched.SetSpeculativeExecution( true );
+
     workerMgr.AddWorkerHost( "grp", "host1" );
+    workerMgr.AddWorkerHost( "grp", "host2" );
 
     vector< WorkerPtr > workers;
     workerMgr.GetWorkers( workers );
-    BOOST_REQUIRE_EQUAL( workers.size(), 1 );
+    BOOST_REQUIRE_EQUAL( workers.size(), 2 );
+
+    const int numTasks = 10;
 
     workerMgr.SetWorkerIP( workers[0], "127.0.0.1" );
-    workerMgr.OnNodePingResponse( "127.0.0.1", 2, 1024 );
+    workerMgr.OnNodePingResponse( "127.0.0.1", numTasks, 1024 );
+    workerMgr.SetWorkerIP( workers[1], "127.0.0.2" );
+    workerMgr.OnNodePingResponse( "127.0.0.2", 2, 1024 );
 
     JobPtr job( jobMgr.CreateJob(
                   "{\"script\" : \"simple.py\","
@@ -998,9 +1265,9 @@ BOOST_AUTO_TEST_CASE( task_completion_exclusive2 ) // 1st job - not exclusive, 2
                   "\"queue_timeout\" : 60,"
                   "\"task_timeout\" : 15,"
                   "\"max_failed_nodes\" : 10,"
-                  "\"num_execution\" : 1,"
+                  "\"num_execution\" : 10,"
                   "\"max_cluster_instances\" : -1,"
-                  "\"max_worker_instances\" : 1,"
+                  "\"max_worker_instances\" : -1,"
                   "\"exclusive\" : false,"
                   "\"no_reschedule\" : false}", true ) );
     BOOST_REQUIRE( job );
@@ -1009,11 +1276,183 @@ BOOST_AUTO_TEST_CASE( task_completion_exclusive2 ) // 1st job - not exclusive, 2
     WorkerJob workerJob;
     string hostIP;
     JobPtr spJob;
+    BOOST_REQUIRE( sched.GetTaskToSend( workerJob, hostIP, spJob ) );
+    BOOST_CHECK_EQUAL( hostIP, "127.0.0.1" );
+    BOOST_REQUIRE_EQUAL( workerJob.GetTotalNumTasks(), numTasks );
 
-    BOOST_CHECK( sched.GetTaskToSend( workerJob, hostIP, spJob ) );
-    BOOST_CHECK( (bool)spJob );
+    vector< WorkerTask > tasks;
+    workerJob.GetTasks( tasks );
+    for( int i = 0; i < numTasks - 1; ++i )
+    {
+        sched.OnTaskCompletion( 0, 10, tasks[i], hostIP );
+    }
 
-    job.reset( jobMgr.CreateJob(
+    // the last task executes much longer than the others
+    std::this_thread::sleep_for( std::chrono::milliseconds( 50 ) );
+    sched.CheckStragglers();
+
+    // copy is placed on the other worker
+    WorkerJob copyJob;
+    string copyHostIP;
+    BOOST_REQUIRE( sched.GetTaskToSend( copyJob, copyHostIP, spJob ) );
+    BOOST_CHECK_EQUAL( copyHostIP, "127.0.0.2" );
+    BOOST_CHECK( copyJob.HasTask( job->GetJobId(), tasks.back().GetTaskId() ) );
+
+    // the copy wins, so the original task is stopped
+    sched.OnTaskCompletion( 0, 10, tasks.back(), copyHostIP );
+
+    const Scheduler::IPToNodeState &ipToNodeState = sched.GetNodeState();
+    for( const auto &it : ipToNodeState )
+    {
+        BOOST_CHECK_EQUAL( it.second.GetNumBusyCPU(), 0 );
+    }
+    BOOST_CHECK_EQUAL( sched.GetScheduledJobs().GetNumJobs(), 0 );
+
+    // late completion of the stopped original is ignored
+    sched.OnTaskCompletion( 0, 100, tasks.back(), hostIP );
+    BOOST_CHECK_EQUAL( ipToNodeState.find( hostIP )->second.GetNumBusyCPU(), 0 );
+}
+
+BOOST_AUTO_TEST_CASE( task_completion_max_exec_at_worker )
+{
+    workerMgr.AddWorkerHost( "grp", "host1" );
+
+    vector< WorkerPtr > workers;
+    workerMgr.GetWorkers( workers );
+    BOOST_REQUIRE_EQUAL( workers.size(), 1 );
+
+    const int numCPU = 8;
+
+    workerMgr.SetWorkerIP( workers[0], "127.0.0.1" );
+    workerMgr.OnNodePingResponse( "127.0.0.1", numCPU, 1024 );
+
+    JobPtr job( jobMgr.CreateJob(
+                  "{\"script\" : \"simple.py\","
+                  "\"language\" : \"python\","
+                  "\"send_script\" : false,"
+                  "\"priority\" : 4,"
+                  "\"job_timeout\" : 120,"
+                  "\"queue_timeout\" : 60,"
+                  "\"task_timeout\" : 15,"
+                  "\"max_failed_nodes\" : 10,"
+                  "\"num_execution\" : 5,"
+                  "\"max_cluster_instances\" : -1,"
+                  "\"max_worker_instances\" : 4,"
+                  "\"exclusive\" : false,"
+                  "\"no_reschedule\" : false,"
+                  "\"max_exec_at_worker\" : 4}", true ) );
+    BOOST_REQUIRE( job );
+    jobMgr.PushJob( job );
+
+    const int maxExecAtWorker = 4;
+    BOOST_REQUIRE_GT( numCPU, maxExecAtWorker );
+
+    WorkerJob workerJob;
+    string hostIP;
+    JobPtr spJob;
+
+    BOOST_CHECK( sched.GetTaskToSend( workerJob, hostIP, spJob ) );
+    BOOST_CHECK( (bool)spJob );
+
+    vector< WorkerTask > tasks;
+    workerJob.GetTasks( tasks );
+    BOOST_CHECK_EQUAL( tasks.size(), maxExecAtWorker );
+}
+
+BOOST_AUTO_TEST_CASE( task_completion_exclusive ) // 1st job - exclusive, 2nd job - not exclusive
+{
+    workerMgr.AddWorkerHost( "grp", "host1" );
+
+    vector< WorkerPtr > workers;
+    workerMgr.GetWorkers( workers );
+    BOOST_REQUIRE_EQUAL( workers.size(), 1 );
+
+    workerMgr.SetWorkerIP( workers[0], "127.0.0.1" );
+    workerMgr.OnNodePingResponse( "127.0.0.1", 2, 1024 );
+
+    JobPtr job( jobMgr.CreateJob(
+                  "{\"script\" : \"simple.py\","
+                  "\"language\" : \"python\","
+                  "\"send_script\" : false,"
+                  "\"priority\" : 4,"
+                  "\"job_timeout\" : 120,"
+                  "\"queue_timeout\" : 60,"
+                  "\"task_timeout\" : 15,"
+                  "\"max_failed_nodes\" : 10,"
+                  "\"num_execution\" : 1,"
+                  "\"max_cluster_instances\" : -1,"
+                  "\"max_worker_instances\" : 1,"
+                  "\"exclusive\" : true,"
+                  "\"no_reschedule\" : false}", true ) );
+    BOOST_REQUIRE( job );
+    jobMgr.PushJob( job );
+
+    WorkerJob workerJob;
+    string hostIP;
+    JobPtr spJob;
+
+    BOOST_CHECK( sched.GetTaskToSend( workerJob, hostIP, spJob ) );
+    BOOST_CHECK( (bool)spJob );
+
+    job.reset( jobMgr.CreateJob(
+                  "{\"script\" : \"simple.py\","
+                  "\"language\" : \"python\","
+                  "\"send_script\" : false,"
+                  "\"priority\" : 4,"
+                  "\"job_timeout\" : 120,"
+                  "\"queue_timeout\" : 60,"
+                  "\"task_timeout\" : 15,"
+                  "\"max_failed_nodes\" : 10,"
+                  "\"num_execution\" : 1,"
+                  "\"max_cluster_instances\" : -1,"
+                  "\"max_worker_instances\" : 1,"
+                  "\"exclusive\" : false,"
+                  "\"no_reschedule\" : false}", true ) );
+    BOOST_REQUIRE( job );
+    jobMgr.PushJob( job );
+
+    workerJob.Reset();
+    spJob.reset();
+
+    BOOST_CHECK_EQUAL( sched.GetTaskToSend( workerJob, hostIP, spJob ), false );
+}
+
+BOOST_AUTO_TEST_CASE( task_completion_exclusive2 ) // 1st job - not exclusive, 2nd job - exclusive
+{
+    workerMgr.AddWorkerHost( "grp", "host1" );
+
+    vector< WorkerPtr > workers;
+    workerMgr.GetWorkers( workers );
+    BOOST_REQUIRE_EQUAL( workers.size(), 1 );
+
+    workerMgr.SetWorkerIP( workers[0], "127.0.0.1" );
+    workerMgr.OnNodePingResponse( "127.0.0.1", 2, 1024 );
+
+    JobPtr job( jobMgr.CreateJob(
+                  "{\"script\" : \"simple.py\","
+                  "\"language\" : \"python\","
+                  "\"send_script\" : false,"
+                  "\"priority\" : 4,"
+                  "\"job_timeout\" : 120,"
+                  "\"queue_timeout\" : 60,"
+                  "\"task_timeout\" : 15,"
+                  "\"max_failed_nodes\" : 10,"
+                  "\"num_execution\" : 1,"
+                  "\"max_cluster_instances\" : -1,"
+                  "\"max_worker_instances\" : 1,"
+                  "\"exclusive\" : false,"
+                  "\"no_reschedule\" : false}", true ) );
+    BOOST_REQUIRE( job );
+    jobMgr.PushJob( job );
+
+    WorkerJob workerJob;
+    string hostIP;
+    JobPtr spJob;
+
+    BOOST_CHECK( sched.GetTaskToSend( workerJob, hostIP, spJob ) );
+    BOOST_CHECK( (bool)spJob );
+
+    job.reset( jobMgr.CreateJob(
                   "{\"script\" : \"simple.py\","
                   "\"language\" : \"python\","
                   "\"send_script\" : false,"
@@ -1098,15 +1537,429 @@ BOOST_AUTO_TEST_CASE( task_completion_exclusive3 ) // 1st _completed_ job - excl
     BOOST_REQUIRE( job );
     jobMgr.PushJob( job );
 
-    workerJob.Reset();
-    spJob.reset();
+    workerJob.Reset();
+    spJob.reset();
+
+    BOOST_CHECK( sched.GetTaskToSend( workerJob, hostIP, spJob ) );
+    BOOST_CHECK( (bool)spJob );
+}
+
+BOOST_AUTO_TEST_CASE( task_completion_delete_worker )
+{
+    workerMgr.AddWorkerHost( "grp", "host1" );
+    workerMgr.AddWorkerHost( "grp", "host2" );
+
+    vector< WorkerPtr > workers;
+    workerMgr.GetWorkers( workers );
+    BOOST_REQUIRE_EQUAL( workers.size(), 2 );
+
+    workerMgr.SetWorkerIP( workers[0], "127.0.0.1" );
+    workerMgr.OnNodePingResponse( "127.0.0.1", 4, 1024 );
+    workerMgr.SetWorkerIP( workers[1], "127.0.0.2" );
+    workerMgr.OnNodePingResponse( "127.0.0.2", 2, 1024 );
+
+    JobPtr job( jobMgr.CreateJob(
+                  "{\"script\" : \"simple.py\","
+                  "\"language\" : \"python\","
+                  "\"send_script\" : false,"
+                  "\"priority\" : 4,"
+                  "\"job_timeout\" : 120,"
+                  "\"queue_timeout\" : 60,"
+                  "\"task_timeout\" : 15,"
+                  "\"max_failed_nodes\" : 10,"
+                  "\"num_execution\" : 1,"
+                  "\"max_cluster_instances\" : -1,"
+                  "\"max_worker_instances\" : 1,"
+                  "\"exclusive\" : false,"
+                  "\"no_reschedule\" : false}", true ) );
+    BOOST_REQUIRE( job );
+    jobMgr.PushJob( job );
+
+    WorkerJob workerJob;
+    string hostIP, hostIP2;
+    JobPtr spJob;
+
+    BOOST_CHECK( sched.GetTaskToSend( workerJob, hostIP, spJob ) );
+    BOOST_CHECK( (bool)spJob );
+
+    sched.DeleteWorker( workers[0]->GetHost() );
+
+    workerJob.Reset();
+    spJob.reset();
+
+    BOOST_CHECK( sched.GetTaskToSend( workerJob, hostIP2, spJob ) );
+    BOOST_CHECK( (bool)spJob );
+    BOOST_CHECK_NE( hostIP, hostIP2 );
+}
+
+BOOST_AUTO_TEST_CASE( on_task_timeout )
+{
+    workerMgr.AddWorkerHost( "grp", "host1" );
+
+    vector< WorkerPtr > workers;
+    workerMgr.GetWorkers( workers );
+    BOOST_REQUIRE_EQUAL( workers.size(), 1 );
+
+    workerMgr.SetWorkerIP( workers[0], "127.0.0.1" );
+    workerMgr.OnNodePingResponse( "127.0.0.1", 2, 1024 );
+
+    JobPtr job( jobMgr.CreateJob(
+                  "{\"script\" : \"simple.py\","
+                  "\"language\" : \"python\","
+                  "\"send_script\" : false,"
+                  "\"priority\" : 4,"
+                  "\"job_timeout\" : 120,"
+                  "\"queue_timeout\" : 60,"
+                  "\"task_timeout\" : 15,"
+                  "\"max_failed_nodes\" : 10,"
+                  "\"num_execution\" : 1,"
+                  "\"max_cluster_instances\" : -1,"
+                  "\"max_worker_instances\" : 1,"
+                  "\"exclusive\" : false,"
+                  "\"no_reschedule\" : false}", true ) );
+    BOOST_REQUIRE( job );
+    jobMgr.PushJob( job );
+
+    WorkerJob workerJob;
+    string hostIP;
+    JobPtr spJob;
+
+    BOOST_CHECK( sched.GetTaskToSend( workerJob, hostIP, spJob ) );
+    BOOST_CHECK( (bool)spJob );
+
+    vector< WorkerTask > tasks;
+    workerJob.GetTasks( tasks );
+    BOOST_CHECK_EQUAL( tasks.empty(), false );
+    vector< WorkerTask >::const_iterator it = tasks.begin();
+    for( ; it != tasks.end(); ++it )
+    {
+        sched.OnTaskTimeout( *it, hostIP );
+    }
+
+    BOOST_CHECK_EQUAL( sched.GetNumNeedReschedule(), tasks.size() );
+}
+
+BOOST_AUTO_TEST_CASE( reschedule_priority_order )
+{
+    workerMgr.AddWorkerHost( "grp", "host1" );
+
+    vector< WorkerPtr > workers;
+    workerMgr.GetWorkers( workers );
+    BOOST_REQUIRE_EQUAL( workers.size(), 1 );
+
+    workerMgr.SetWorkerIP( workers[0], "127.0.0.1" );
+    workerMgr.OnNodePingResponse( "127.0.0.1", 2, 1024 );
+
+    JobPtr jobLow( jobMgr.CreateJob(
+                  "{\"script\" : \"simple.py\","
+                  "\"language\" : \"python\","
+                  "\"send_script\" : false,"
+                  "\"priority\" : 4,"
+                  "\"job_timeout\" : 120,"
+                  "\"queue_timeout\" : 60,"
+                  "\"task_timeout\" : 15,"
+                  "\"max_failed_nodes\" : 10,"
+                  "\"num_execution\" : 1,"
+                  "\"max_cluster_instances\" : -1,"
+                  "\"max_worker_instances\" : 1,"
+                  "\"exclusive\" : false,"
+                  "\"no_reschedule\" : false}", true ) );
+    BOOST_REQUIRE( jobLow );
+    jobMgr.PushJob( jobLow );
+
+    JobPtr jobHigh( jobMgr.CreateJob(
+                  "{\"script\" : \"simple.py\","
+                  "\"language\" : \"python\","
+                  "\"send_script\" : false,"
+                  "\"priority\" : 1,"
+                  "\"job_timeout\" : 120,"
+                  "\"queue_timeout\" : 60,"
+                  "\"task_timeout\" : 15,"
+                  "\"max_failed_nodes\" : 10,"
+                  "\"num_execution\" : 1,"
+                  "\"max_cluster_instances\" : -1,"
+                  "\"max_worker_instances\" : 1,"
+                  "\"exclusive\" : false,"
+                  "\"no_reschedule\" : false}", true ) );
+    BOOST_REQUIRE( jobHigh );
+    jobMgr.PushJob( jobHigh );
+
+    for( int i = 0; i < 2; ++i )
+    {
+        WorkerJob workerJob;
+        string hostIP;
+        JobPtr spJob;
+        BOOST_REQUIRE( sched.GetTaskToSend( workerJob, hostIP, spJob ) );
+
+        vector< WorkerTask > tasks;
+        workerJob.GetTasks( tasks );
+        for( const auto &task : tasks )
+        {
+            sched.OnTaskTimeout( task, hostIP );
+        }
+    }
+    BOOST_CHECK_EQUAL( sched.GetNumNeedReschedule(), 2 );
+    BOOST_CHECK_EQUAL( sched.GetNeedReschedule().size(), 2 );
+
+    // failed worker can't take rescheduled tasks of the same jobs
+    {
+        WorkerJob workerJob;
+        string hostIP;
+        JobPtr spJob;
+        BOOST_CHECK( !sched.GetTaskToSend( workerJob, hostIP, spJob ) );
+    }
+
+    workerMgr.AddWorkerHost( "grp", "host2" );
+    workers.clear();
+    workerMgr.GetWorkers( workers );
+    BOOST_REQUIRE_EQUAL( workers.size(), 2 );
+    for( auto &worker : workers )
+    {
+        if ( worker->GetHost() == "host2" )
+            workerMgr.SetWorkerIP( worker, "127.0.0.2" );
+    }
+    workerMgr.OnNodePingResponse( "127.0.0.2", 1, 1024 );
+
+    WorkerJob workerJob;
+    string hostIP;
+    JobPtr spJob;
+    BOOST_REQUIRE( sched.GetTaskToSend( workerJob, hostIP, spJob ) );
+    BOOST_CHECK_EQUAL( hostIP, "127.0.0.2" );
+    BOOST_CHECK_EQUAL( spJob->GetJobId(), jobHigh->GetJobId() );
+    BOOST_CHECK_EQUAL( sched.GetNumNeedReschedule(), 1 );
+}
+
+BOOST_AUTO_TEST_CASE( on_task_timeout_after_completion )
+{
+    workerMgr.AddWorkerHost( "grp", "host1" );
+
+    vector< WorkerPtr > workers;
+    workerMgr.GetWorkers( workers );
+    BOOST_REQUIRE_EQUAL( workers.size(), 1 );
+
+    workerMgr.SetWorkerIP( workers[0], "127.0.0.1" );
+    workerMgr.OnNodePingResponse( "127.0.0.1", 2, 1024 );
+
+    JobPtr job( jobMgr.CreateJob(
+                  "{\"script\" : \"simple.py\","
+                  "\"language\" : \"python\","
+                  "\"send_script\" : false,"
+                  "\"priority\" : 4,"
+                  "\"job_timeout\" : 120,"
+                  "\"queue_timeout\" : 60,"
+                  "\"task_timeout\" : 15,"
+                  "\"max_failed_nodes\" : 10,"
+                  "\"num_execution\" : 1,"
+                  "\"max_cluster_instances\" : -1,"
+                  "\"max_worker_instances\" : 1,"
+                  "\"exclusive\" : false,"
+                  "\"no_reschedule\" : false}", true ) );
+    BOOST_REQUIRE( job );
+    jobMgr.PushJob( job );
+
+    WorkerJob workerJob;
+    string hostIP;
+    JobPtr spJob;
+
+    BOOST_CHECK( sched.GetTaskToSend( workerJob, hostIP, spJob ) );
+    BOOST_CHECK( (bool)spJob );
+
+    vector< WorkerTask > tasks;
+    workerJob.GetTasks( tasks );
+    BOOST_CHECK_EQUAL( tasks.empty(), false );
+    vector< WorkerTask >::const_iterator it = tasks.begin();
+    for( ; it != tasks.end(); ++it )
+    {
+        sched.OnTaskCompletion( 0, 10, *it, hostIP );
+    }
+
+    for( it = tasks.begin(); it != tasks.end(); ++it )
+    {
+        sched.OnTaskTimeout( *it, hostIP );
+    }
+
+    BOOST_CHECK( sched.GetNeedReschedule().empty() );
+}
+
+BOOST_AUTO_TEST_CASE( gang_job )
+{
+    sched.SetGangTimeout( 1 );
+
+    workerMgr.AddWorkerHost( "grp", "host1" );
+    workerMgr.AddWorkerHost( "grp", "host2" );
+
+    vector< WorkerPtr > workers;
+    workerMgr.GetWorkers( workers );
+    BOOST_REQUIRE_EQUAL( workers.size(), 2 );
+
+    const int numCPU = 4;
+    workerMgr.SetWorkerIP( workers[0], "127.0.0.1" );
+    workerMgr.OnNodePingResponse( "127.0.0.1", numCPU, 1024 );
+    workerMgr.SetWorkerIP( workers[1], "127.0.0.2" );
+    workerMgr.OnNodePingResponse( "127.0.0.2", numCPU, 1024 );
+
+    auto createJob = [&]( int numExec, bool gang ) -> JobPtr
+    {
+        return JobPtr( jobMgr.CreateJob(
+                  "{\"script\" : \"simple.py\","
+                  "\"language\" : \"python\","
+                  "\"send_script\" : false,"
+                  "\"priority\" : 4,"
+                  "\"job_timeout\" : 120,"
+                  "\"queue_timeout\" : 60,"
+                  "\"task_timeout\" : 15,"
+                  "\"max_failed_nodes\" : 10,"
+                  "\"num_execution\" : " + std::to_string( numExec ) + ","
+                  "\"max_cluster_instances\" : -1,"
+                  "\"max_worker_instances\" : -1,"
+                  "\"exclusive\" : false,"
+                  "\"no_reschedule\" : false,"
+                  "\"gang\" : " + ( gang ? "true" : "false" ) + "}", true ) );
+    };
+
+    JobPtr job( createJob( numCPU, false ) );
+    BOOST_REQUIRE( job );
+    jobMgr.PushJob( job );
+
+    WorkerJob workerJob;
+    string hostIP;
+    JobPtr j;
+    BOOST_REQUIRE( sched.GetTaskToSend( workerJob, hostIP, j ) );
+    BOOST_REQUIRE_EQUAL( workerJob.GetTotalNumTasks(), numCPU );
+
+    // the gang job doesn't fit in the cluster, so its tasks aren't sent,
+    // but the free worker is reserved for it
+    JobPtr gangJob( createJob( numCPU + 2, true ) );
+    BOOST_REQUIRE( gangJob );
+    BOOST_CHECK( gangJob->IsGang() );
+    jobMgr.PushJob( gangJob );
+
+    WorkerJob gangWorkerJob;
+    string gangHostIP;
+    BOOST_CHECK( !sched.GetTaskToSend( gangWorkerJob, gangHostIP, j ) );
+
+    const Scheduler::IPToNodeState &ipToNodeState = sched.GetNodeState();
+    for( const auto &it : ipToNodeState )
+    {
+        BOOST_CHECK_EQUAL( it.second.GetNumFreeCPU(), 0 );
+    }
+
+    vector< WorkerTask > tasks;
+    workerJob.GetTasks( tasks );
+    sched.OnTaskCompletion( 0, 10, tasks[0], hostIP );
+    sched.OnTaskCompletion( 0, 10, tasks[1], hostIP );
+
+    // now all tasks of the gang job are sent at once
+    TasksToSend gangTasks;
+    BOOST_REQUIRE( sched.GetTasksToSend( gangTasks, 10 ) );
+    BOOST_REQUIRE_EQUAL( gangTasks.size(), 2 );
+    int numGangTasks = 0;
+    for( const auto &task : gangTasks )
+    {
+        BOOST_CHECK_EQUAL( task.job_->GetJobId(), gangJob->GetJobId() );
+        numGangTasks += task.workerJob_.GetNumTasks( gangJob->GetJobId() );
+    }
+    BOOST_CHECK_EQUAL( numGangTasks, numCPU + 2 );
+
+    // gang job, which never fits in the cluster, fails after the reservation timeout
+    sched.OnTaskCompletion( 0, 10, tasks[2], hostIP );
+    sched.OnTaskCompletion( 0, 10, tasks[3], hostIP );
+
+    JobPtr bigJob( createJob( 3 * numCPU, true ) );
+    BOOST_REQUIRE( bigJob );
+    jobMgr.PushJob( bigJob );
+
+    TasksToSend bigTasks;
+    BOOST_CHECK( !sched.GetTasksToSend( bigTasks, 10 ) );
+    BOOST_CHECK_EQUAL( sched.GetScheduledJobs().GetNumJobs(), 2 );
+
+    std::this_thread::sleep_for( std::chrono::milliseconds( 1100 ) );
+    sched.CheckGangReservation();
+    BOOST_CHECK_EQUAL( sched.GetScheduledJobs().GetNumJobs(), 1 );
+
+    int numFreeCPU = 0;
+    for( const auto &it : ipToNodeState )
+    {
+        numFreeCPU += it.second.GetNumFreeCPU();
+    }
+    BOOST_CHECK_EQUAL( numFreeCPU, 2 );
+}
+
+BOOST_AUTO_TEST_CASE( preemption )
+{
+    sched.SetPreemptionBudget( 2 );
+
+    workerMgr.AddWorkerHost( "grp", "host1" );
+
+    vector< WorkerPtr > workers;
+    workerMgr.GetWorkers( workers );
+    BOOST_REQUIRE_EQUAL( workers.size(), 1 );
+
+    const int numCPU = 4;
+    workerMgr.SetWorkerIP( workers[0], "127.0.0.1" );
+    workerMgr.OnNodePingResponse( "127.0.0.1", numCPU, 1024 );
+
+    auto createJob = [&]( int priority, int numExec ) -> JobPtr
+    {
+        return JobPtr( jobMgr.CreateJob(
+                  "{\"script\" : \"simple.py\","
+                  "\"language\" : \"python\","
+                  "\"send_script\" : false,"
+                  "\"priority\" : " + std::to_string( priority ) + ","
+                  "\"job_timeout\" : 120,"
+                  "\"queue_timeout\" : 60,"
+                  "\"task_timeout\" : 15,"
+                  "\"max_failed_nodes\" : 1,"
+                  "\"num_execution\" : " + std::to_string( numExec ) + ","
+                  "\"max_cluster_instances\" : -1,"
+                  "\"max_worker_instances\" : -1,"
+                  "\"exclusive\" : false,"
+                  "\"no_reschedule\" : false}", true ) );
+    };
+
+    JobPtr lowJob( createJob( 8, numCPU ) );
+    BOOST_REQUIRE( lowJob );
+    jobMgr.PushJob( lowJob );
 
-    BOOST_CHECK( sched.GetTaskToSend( workerJob, hostIP, spJob ) );
-    BOOST_CHECK( (bool)spJob );
+    WorkerJob workerJob;
+    string hostIP;
+    JobPtr j;
+    BOOST_REQUIRE( sched.GetTaskToSend( workerJob, hostIP, j ) );
+    BOOST_REQUIRE_EQUAL( workerJob.GetTotalNumTasks(), numCPU );
+
+    // cluster is full, so tasks of the less prioritized job are preempted
+    // within the budget limit
+    JobPtr highJob( createJob( 1, 3 ) );
+    BOOST_REQUIRE( highJob );
+    jobMgr.PushJob( highJob );
+
+    WorkerJob highWorkerJob;
+    BOOST_REQUIRE( sched.GetTaskToSend( highWorkerJob, hostIP, j ) );
+    BOOST_CHECK_EQUAL( j->GetJobId(), highJob->GetJobId() );
+    BOOST_CHECK_EQUAL( highWorkerJob.GetNumTasks( highJob->GetJobId() ), 2 );
+
+    const Scheduler::IPToNodeState &ipToNodeState = sched.GetNodeState();
+    const NodeState &nodeState = ipToNodeState.find( hostIP )->second;
+    BOOST_CHECK_EQUAL( nodeState.GetNumBusyCPU(), numCPU );
+    BOOST_CHECK_EQUAL( nodeState.GetWorker()->GetJob().GetNumTasks( lowJob->GetJobId() ), 2 );
+
+    // stop errors of the preempted tasks don't fail the job
+    vector< WorkerTask > tasks;
+    workerJob.GetTasks( tasks );
+    for( const auto &task : tasks )
+    {
+        if ( !nodeState.GetWorker()->GetJob().HasTask( task.GetJobId(), task.GetTaskId() ) )
+            sched.OnTaskCompletion( -1, 0, task, hostIP );
+    }
+    BOOST_CHECK_EQUAL( nodeState.GetNumBusyCPU(), numCPU );
+    BOOST_CHECK_EQUAL( sched.GetScheduledJobs().GetNumJobs(), 2 );
+    BOOST_CHECK_EQUAL( sched.GetFailedWorkers().GetFailedNodesCnt( lowJob->GetJobId() ), 0 );
 }
 
-BOOST_AUTO_TEST_CASE( task_completion_delete_worker )
+BOOST_AUTO_TEST_CASE( locality_delay )
 {
+    sched.SetLocalityDelay( 1 );
+
     workerMgr.AddWorkerHost( "grp", "host1" );
     workerMgr.AddWorkerHost( "grp", "host2" );
 
@@ -1114,12 +1967,15 @@ BOOST_AUTO_TEST_CASE( task_completion_delete_worker )
     workerMgr.GetWorkers( workers );
     BOOST_REQUIRE_EQUAL( workers.size(), 2 );
 
+    const int numCPU = 2;
     workerMgr.SetWorkerIP( workers[0], "127.0.0.1" );
-    workerMgr.OnNodePingResponse( "127.0.0.1", 4, 1024 );
+    workerMgr.OnNodePingResponse( "127.0.0.1", numCPU, 1024 );
     workerMgr.SetWorkerIP( workers[1], "127.0.0.2" );
-    workerMgr.OnNodePingResponse( "127.0.0.2", 2, 1024 );
+    workerMgr.OnNodePingResponse( "127.0.0.2", 2 * numCPU, 1024 );
 
-    JobPtr job( jobMgr.CreateJob(
+    auto createJob = [&]( const std::string &params ) -> JobPtr
+    {
+        return JobPtr( jobMgr.CreateJob(
                   "{\"script\" : \"simple.py\","
                   "\"language\" : \"python\","
                   "\"send_script\" : false,"
@@ -1128,32 +1984,71 @@ BOOST_AUTO_TEST_CASE( task_completion_delete_worker )
                   "\"queue_timeout\" : 60,"
                   "\"task_timeout\" : 15,"
                   "\"max_failed_nodes\" : 10,"
-                  "\"num_execution\" : 1,"
+                  "\"num_execution\" : 2,"
                   "\"max_cluster_instances\" : -1,"
-                  "\"max_worker_instances\" : 1,"
+                  "\"max_worker_instances\" : -1,"
                   "\"exclusive\" : false,"
-                  "\"no_reschedule\" : false}", true ) );
+                  "\"no_reschedule\" : false," + params + "}", true ) );
+    };
+
+    auto completeTasks = [&]( const WorkerJob &workerJob, const string &hostIP )
+    {
+        vector< WorkerTask > tasks;
+        workerJob.GetTasks( tasks );
+        for( const auto &task : tasks )
+        {
+            sched.OnTaskCompletion( 0, 10, task, hostIP );
+        }
+    };
+
+    // data set becomes local for host1
+    JobPtr job( createJob( "\"data_set\" : \"chunks\", \"hosts\" : [\"host1\"]" ) );
     BOOST_REQUIRE( job );
     jobMgr.PushJob( job );
 
     WorkerJob workerJob;
-    string hostIP, hostIP2;
-    JobPtr spJob;
-
-    BOOST_CHECK( sched.GetTaskToSend( workerJob, hostIP, spJob ) );
-    BOOST_CHECK( (bool)spJob );
-
-    sched.DeleteWorker( workers[0]->GetHost() );
-
-    workerJob.Reset();
-    spJob.reset();
-
-    BOOST_CHECK( sched.GetTaskToSend( workerJob, hostIP2, spJob ) );
-    BOOST_CHECK( (bool)spJob );
-    BOOST_CHECK_NE( hostIP, hostIP2 );
+    string hostIP;
+    JobPtr j;
+    BOOST_REQUIRE( sched.GetTaskToSend( workerJob, hostIP, j ) );
+    BOOST_CHECK_EQUAL( hostIP, "127.0.0.1" );
+    completeTasks( workerJob, hostIP );
+
+    // host1 is busy with other job
+    JobPtr busyJob( createJob( "\"hosts\" : [\"host1\"]" ) );
+    BOOST_REQUIRE( busyJob );
+    jobMgr.PushJob( busyJob );
+
+    WorkerJob busyWorkerJob;
+    BOOST_REQUIRE( sched.GetTaskToSend( busyWorkerJob, hostIP, j ) );
+    BOOST_CHECK_EQUAL( hostIP, "127.0.0.1" );
+
+    // job waits for the local worker, instead of taking more free host2
+    JobPtr localJob( createJob( "\"data_set\" : \"chunks\"" ) );
+    BOOST_REQUIRE( localJob );
+    jobMgr.PushJob( localJob );
+
+    WorkerJob localWorkerJob;
+    BOOST_CHECK( !sched.GetTaskToSend( localWorkerJob, hostIP, j ) );
+
+    completeTasks( busyWorkerJob, "127.0.0.1" );
+    BOOST_REQUIRE( sched.GetTaskToSend( localWorkerJob, hostIP, j ) );
+    BOOST_CHECK_EQUAL( hostIP, "127.0.0.1" );
+    BOOST_CHECK_EQUAL( localWorkerJob.GetNumTasks( localJob->GetJobId() ), 2 );
+
+    // after the locality delay, any worker is taken
+    JobPtr remoteJob( createJob( "\"data_set\" : \"chunks\"" ) );
+    BOOST_REQUIRE( remoteJob );
+    jobMgr.PushJob( remoteJob );
+
+    WorkerJob remoteWorkerJob;
+    BOOST_CHECK( !sched.GetTaskToSend( remoteWorkerJob, hostIP, j ) );
+
+    std::this_thread::sleep_for( std::chrono::milliseconds( 1100 ) );
+    BOOST_REQUIRE( sched.GetTaskToSend( remoteWorkerJob, hostIP, j ) );
+    BOOST_CHECK_EQUAL( hostIP, "127.0.0.2" );
 }
 
-BOOST_AUTO_TEST_CASE( on_task_timeout )
+BOOST_AUTO_TEST_CASE( task_completions_batch )
 {
     workerMgr.AddWorkerHost( "grp", "host1" );
 
@@ -1161,8 +2056,9 @@ BOOST_AUTO_TEST_CASE( on_task_timeout )
     workerMgr.GetWorkers( workers );
     BOOST_REQUIRE_EQUAL( workers.size(), 1 );
 
+    const int numTasks = 4;
     workerMgr.SetWorkerIP( workers[0], "127.0.0.1" );
-    workerMgr.OnNodePingResponse( "127.0.0.1", 2, 1024 );
+    workerMgr.OnNodePingResponse( "127.0.0.1", numTasks, 1024 );
 
     JobPtr job( jobMgr.CreateJob(
                   "{\"script\" : \"simple.py\","
@@ -1173,45 +2069,47 @@ BOOST_AUTO_TEST_CASE( on_task_timeout )
                   "\"queue_timeout\" : 60,"
                   "\"task_timeout\" : 15,"
                   "\"max_failed_nodes\" : 10,"
-                  "\"num_execution\" : 1,"
+                  "\"num_execution\" : 4,"
                   "\"max_cluster_instances\" : -1,"
-                  "\"max_worker_instances\" : 1,"
+                  "\"max_worker_instances\" : -1,"
                   "\"exclusive\" : false,"
-                  "\"no_reschedule\" : false}", true ) );
+                  "\"no_reschedule\" : true}", true ) );
     BOOST_REQUIRE( job );
     jobMgr.PushJob( job );
 
     WorkerJob workerJob;
     string hostIP;
-    JobPtr spJob;
-
-    BOOST_CHECK( sched.GetTaskToSend( workerJob, hostIP, spJob ) );
-    BOOST_CHECK( (bool)spJob );
+    JobPtr j;
+    BOOST_REQUIRE( sched.GetTaskToSend( workerJob, hostIP, j ) );
+    BOOST_REQUIRE_EQUAL( workerJob.GetTotalNumTasks(), numTasks );
 
     vector< WorkerTask > tasks;
     workerJob.GetTasks( tasks );
-    BOOST_CHECK_EQUAL( tasks.empty(), false );
-    vector< WorkerTask >::const_iterator it = tasks.begin();
-    for( ; it != tasks.end(); ++it )
+
+    // duplicated and failed results are processed in the same batch
+    TaskCompletions completions;
+    for( const auto &task : tasks )
     {
-        sched.OnTaskTimeout( *it, hostIP );
+        completions.push_back( TaskCompletion{ 0, 10, task, hostIP } );
     }
+    completions.push_back( TaskCompletion{ 0, 10, tasks[0], hostIP } );
+    completions[1].errCode_ = -1;
+    sched.OnTaskCompletions( completions );
 
-    BOOST_CHECK_EQUAL( sched.GetNeedReschedule().size(), tasks.size() );
+    const Scheduler::IPToNodeState &ipToNodeState = sched.GetNodeState();
+    BOOST_CHECK_EQUAL( ipToNodeState.find( hostIP )->second.GetNumBusyCPU(), 0 );
+    BOOST_CHECK_EQUAL( sched.GetScheduledJobs().GetNumJobs(), 0 );
+    BOOST_CHECK_EQUAL( sched.GetNumNeedReschedule(), 0 );
 }
 
-BOOST_AUTO_TEST_CASE( on_task_timeout_after_completion )
+BOOST_AUTO_TEST_CASE( planning_window )
 {
-    workerMgr.AddWorkerHost( "grp", "host1" );
-
-    vector< WorkerPtr > workers;
-    workerMgr.GetWorkers( workers );
-    BOOST_REQUIRE_EQUAL( workers.size(), 1 );
-
-    workerMgr.SetWorkerIP( workers[0], "127.0.0.1" );
-    workerMgr.OnNodePingResponse( "127.0.0.1", 2, 1024 );
+    sched.SetPlanningWindow( 10 );
 
-    JobPtr job( jobMgr.CreateJob(
+    const int numJobs = 4;
+    for( int i = 0; i < numJobs; ++i )
+    {
+        JobPtr job( jobMgr.CreateJob(
                   "{\"script\" : \"simple.py\","
                   "\"language\" : \"python\","
                   "\"send_script\" : false,"
@@ -1222,34 +2120,30 @@ BOOST_AUTO_TEST_CASE( on_task_timeout_after_completion )
                   "\"max_failed_nodes\" : 10,"
                   "\"num_execution\" : 1,"
                   "\"max_cluster_instances\" : -1,"
-                  "\"max_worker_instances\" : 1,"
+                  "\"max_worker_instances\" : -1,"
                   "\"exclusive\" : false,"
                   "\"no_reschedule\" : false}", true ) );
-    BOOST_REQUIRE( job );
-    jobMgr.PushJob( job );
+        BOOST_REQUIRE( job );
+        jobMgr.PushJob( job );
+    }
 
-    WorkerJob workerJob;
-    string hostIP;
-    JobPtr spJob;
+    workerMgr.AddWorkerHost( "grp", "host1" );
 
-    BOOST_CHECK( sched.GetTaskToSend( workerJob, hostIP, spJob ) );
-    BOOST_CHECK( (bool)spJob );
+    vector< WorkerPtr > workers;
+    workerMgr.GetWorkers( workers );
+    BOOST_REQUIRE_EQUAL( workers.size(), 1 );
 
-    vector< WorkerTask > tasks;
-    workerJob.GetTasks( tasks );
-    BOOST_CHECK_EQUAL( tasks.empty(), false );
-    vector< WorkerTask >::const_iterator it = tasks.begin();
-    for( ; it != tasks.end(); ++it )
-    {
-        sched.OnTaskCompletion( 0, 10, *it, hostIP );
-    }
+    // jobs, queued before worker appearance, are taken at once,
+    // but not more than the free CPU's of the cluster
+    workerMgr.SetWorkerIP( workers[0], "127.0.0.1" );
+    workerMgr.OnNodePingResponse( "127.0.0.1", numJobs - 1, 1024 );
 
-    for( it = tasks.begin(); it != tasks.end(); ++it )
-    {
-        sched.OnTaskTimeout( *it, hostIP );
-    }
+    TasksToSend tasks;
+    BOOST_CHECK( !sched.GetTasksToSend( tasks, 10 ) );
+    BOOST_CHECK_EQUAL( sched.GetScheduledJobs().GetNumJobs(), numJobs - 1 );
 
-    BOOST_CHECK( sched.GetNeedReschedule().empty() );
+    BOOST_REQUIRE( sched.GetTasksToSend( tasks, 10 ) );
+    BOOST_CHECK_EQUAL( tasks.size(), numJobs - 1 );
 }
 
 BOOST_AUTO_TEST_CASE( on_job_timeout )
@@ -1330,6 +2224,12 @@ BOOST_AUTO_TEST_CASE( stop_job )
     BOOST_CHECK_GT( sched.GetScheduledJobs().GetNumJobs(), 0 );
     sched.StopJob( workerJob.GetJobId() );
     BOOST_CHECK_EQUAL( sched.GetScheduledJobs().GetNumJobs(), 0 );
+
+    const Scheduler::IPToNodeState &ipToNodeState = sched.GetNodeState();
+    auto it = ipToNodeState.find( "127.0.0.1" );
+    BOOST_REQUIRE( it != ipToNodeState.end() );
+    BOOST_CHECK_EQUAL( it->second.GetNumFreeCPU(), 2 );
+    BOOST_CHECK( !workers[0]->GetJob().HasJob( workerJob.GetJobId() ) );
 }
 
 BOOST_AUTO_TEST_CASE( stop_all_jobs )
@@ -1537,4 +2437,239 @@ BOOST_AUTO_TEST_CASE( blacklist_groups )
     BOOST_CHECK( hostIP == workers[0]->GetIP() ); // faster second worker is in groups blacklist
 }
 
+BOOST_AUTO_TEST_CASE( group_shards )
+{
+    workerMgr.AddWorkerHost( "grp1", "host1" );
+    workerMgr.AddWorkerHost( "grp2", "host2" );
+
+    vector< WorkerPtr > workers;
+    workerMgr.GetWorkers( workers );
+    BOOST_REQUIRE_EQUAL( workers.size(), 2 );
+
+    const int numCPU = 4;
+    workerMgr.SetWorkerIP( workers[0], "127.0.0.1" );
+    workerMgr.OnNodePingResponse( "127.0.0.1", numCPU, 1024 );
+    workerMgr.SetWorkerIP( workers[1], "127.0.0.2" );
+    workerMgr.OnNodePingResponse( "127.0.0.2", numCPU, 1024 );
+
+    auto createJob = [&]( const std::string &params ) -> JobPtr
+    {
+        return JobPtr( jobMgr.CreateJob(
+                  "{\"script\" : \"simple.py\","
+                  "\"language\" : \"python\","
+                  "\"send_script\" : false,"
+                  "\"priority\" : 4,"
+                  "\"job_timeout\" : 120,"
+                  "\"queue_timeout\" : 60,"
+                  "\"task_timeout\" : 15,"
+                  "\"max_failed_nodes\" : 10,"
+                  "\"max_cluster_instances\" : -1,"
+                  "\"max_worker_instances\" : -1,"
+                  "\"exclusive\" : false,"
+                  "\"no_reschedule\" : false," + params + "}", true ) );
+    };
+
+    // job fills up the only shard of its group
+    JobPtr groupJob( createJob( "\"num_execution\" : 4, \"groups\" : [\"grp1\"]" ) );
+    BOOST_REQUIRE( groupJob );
+    jobMgr.PushJob( groupJob );
+
+    TasksToSend tasks;
+    BOOST_REQUIRE( sched.GetTasksToSend( tasks, 10 ) );
+    BOOST_REQUIRE_EQUAL( tasks.size(), 1 );
+    BOOST_CHECK_EQUAL( tasks[0].hostIP_, "127.0.0.1" );
+
+    // the other shard still takes new jobs
+    JobPtr job( createJob( "\"num_execution\" : 4" ) );
+    BOOST_REQUIRE( job );
+    jobMgr.PushJob( job );
+
+    tasks.clear();
+    BOOST_REQUIRE( sched.GetTasksToSend( tasks, 10 ) );
+    BOOST_REQUIRE_EQUAL( tasks.size(), 1 );
+    BOOST_CHECK_EQUAL( tasks[0].hostIP_, "127.0.0.2" );
+    BOOST_CHECK_EQUAL( tasks[0].workerJob_.GetNumTasks( job->GetJobId() ), numCPU );
+}
+
+BOOST_AUTO_TEST_CASE( eligible_jobs_by_group )
+{
+    workerMgr.AddWorkerHost( "grp1", "host1" );
+    workerMgr.AddWorkerHost( "grp2", "host2" );
+
+    vector< WorkerPtr > workers;
+    workerMgr.GetWorkers( workers );
+    BOOST_REQUIRE_EQUAL( workers.size(), 2 );
+
+    workerMgr.SetWorkerIP( workers[0], "127.0.0.1" );
+    workerMgr.OnNodePingResponse( "127.0.0.1", 1, 1024 );
+    workerMgr.SetWorkerIP( workers[1], "127.0.0.2" );
+    workerMgr.OnNodePingResponse( "127.0.0.2", 1, 1024 );
+
+    JobPtr job( jobMgr.CreateJob(
+                  "{\"script\" : \"simple.py\","
+                  "\"language\" : \"python\","
+                  "\"send_script\" : false,"
+                  "\"priority\" : 1,"
+                  "\"job_timeout\" : 120,"
+                  "\"queue_timeout\" : 60,"
+                  "\"task_timeout\" : 15,"
+                  "\"max_failed_nodes\" : 10,"
+                  "\"num_execution\" : 1,"
+                  "\"max_cluster_instances\" : -1,"
+                  "\"max_worker_instances\" : 1,"
+                  "\"exclusive\" : false,"
+                  "\"no_reschedule\" : false,"
+                  "\"groups\" : [\"grp1\"]}", true ) );
+    BOOST_REQUIRE( job );
+    jobMgr.PushJob( job );
+
+    JobPtr job2( jobMgr.CreateJob(
+                  "{\"script\" : \"simple.py\","
+                  "\"language\" : \"python\","
+                  "\"send_script\" : false,"
+                  "\"priority\" : 4,"
+                  "\"job_timeout\" : 120,"
+                  "\"queue_timeout\" : 60,"
+                  "\"task_timeout\" : 15,"
+                  "\"max_failed_nodes\" : 10,"
+                  "\"num_execution\" : 1,"
+                  "\"max_cluster_instances\" : -1,"
+                  "\"max_worker_instances\" : 1,"
+                  "\"exclusive\" : false,"
+                  "\"no_reschedule\" : false}", true ) );
+    BOOST_REQUIRE( job2 );
+    jobMgr.PushJob( job2 );
+
+    for( int i = 0; i < 2; ++i )
+    {
+        WorkerJob workerJob;
+        string hostIP;
+        JobPtr spJob;
+
+        BOOST_REQUIRE( sched.GetTaskToSend( workerJob, hostIP, spJob ) );
+        // higher priority job is permitted only for the first worker
+        if ( hostIP == workers[0]->GetIP() )
+            BOOST_CHECK_EQUAL( spJob->GetJobId(), job->GetJobId() );
+        else
+            BOOST_CHECK_EQUAL( spJob->GetJobId(), job2->GetJobId() );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( dispatch_skips_sent_jobs )
+{
+    workerMgr.AddWorkerHost( "grp", "host1" );
+    vector< WorkerPtr > workers;
+    workerMgr.GetWorkers( workers );
+    workerMgr.SetWorkerIP( workers[0], "127.0.0.1" );
+    workerMgr.OnNodePingResponse( "127.0.0.1", 128, 1024 );
+
+    // running jobs with all tasks sent aren't visited by the placement
+    const int numJobs = 100;
+    for( int i = 0; i < numJobs; ++i )
+    {
+        JobPtr job( new Job( "", "python", 1, 1, 1, -1, -1, 1, 1, 1, false, false ) );
+        jobMgr.PushJob( job );
+
+        TasksToSend tasks;
+        while( sched.GetTasksToSend( tasks, 1 ) );
+    }
+    BOOST_CHECK_EQUAL( sched.GetScheduledJobs().GetNumJobs(), numJobs );
+    BOOST_CHECK_EQUAL( sched.GetNodeState().begin()->second.GetNumBusyCPU(), numJobs );
+
+    std::ostringstream ss;
+    sched.GetStat().Print( ss );
+    std::string line;
+    std::istringstream stat( ss.str() );
+    while( std::getline( stat, line ) && line.find( "jobs examined:" ) != 0 );
+    BOOST_CHECK( line.find( ", max = 1" ) != std::string::npos );
+}
+
+BOOST_AUTO_TEST_CASE( scheduler_stat )
+{
+    Histogram h;
+    for( int i = 1; i <= 100; ++i )
+        h.Add( i );
+    BOOST_CHECK_EQUAL( h.GetCount(), 100 );
+    BOOST_CHECK_EQUAL( h.GetMax(), 100 );
+    BOOST_CHECK_EQUAL( h.GetMean(), 50 );
+    // percentiles are bucket upper bounds
+    BOOST_CHECK_EQUAL( h.GetPercentile( 50 ), 63 );
+    BOOST_CHECK_EQUAL( h.GetPercentile( 99 ), 100 );
+
+    workerMgr.AddWorkerHost( "grp", "host1" );
+    vector< WorkerPtr > workers;
+    workerMgr.GetWorkers( workers );
+    workerMgr.SetWorkerIP( workers[0], "127.0.0.1" );
+    workerMgr.OnNodePingResponse( "127.0.0.1", 1, 1024 );
+
+    JobPtr job( new Job( "", "python", 1, 1, 1, 1, 1, 1, 1, 1, false, false ) );
+    jobMgr.PushJob( job );
+
+    WorkerJob workerJob;
+    string hostIP;
+    JobPtr spJob;
+    BOOST_REQUIRE( sched.GetTaskToSend( workerJob, hostIP, spJob ) );
+    sched.OnTaskCompletion( 0, 1, WorkerTask( job->GetJobId(), 0 ), hostIP );
+
+    std::ostringstream ss;
+    sched.GetStat().Print( ss );
+    const std::string stat = ss.str();
+    BOOST_CHECK( stat.find( "get task time: n = 1," ) != std::string::npos );
+    BOOST_CHECK( stat.find( "task completion time: n = 1," ) != std::string::npos );
+    BOOST_CHECK( stat.find( "workers lock wait: n = 2," ) != std::string::npos );
+    BOOST_CHECK( stat.find( "nodes examined: n = 1, mean = 1," ) != std::string::npos );
+    BOOST_CHECK( stat.find( "jobs examined: n = 1, mean = 1," ) != std::string::npos );
+}
+
+BOOST_AUTO_TEST_CASE( completion_effects_deferred )
+{
+    MockCompletionExecutor executor;
+    sched.SetCompletionExecutor( &executor );
+
+    workerMgr.AddWorkerHost( "grp", "host1" );
+    vector< WorkerPtr > workers;
+    workerMgr.GetWorkers( workers );
+    workerMgr.SetWorkerIP( workers[0], "127.0.0.1" );
+    workerMgr.OnNodePingResponse( "127.0.0.1", 1, 1024 );
+
+    JobPtr job( new Job( "", "python", 1, 1, 1, 1, 1, 1, 1, 1, false, false ) );
+    job->SetName( "named" );
+    jobMgr.PushJob( job );
+
+    WorkerJob workerJob;
+    string hostIP;
+    JobPtr spJob;
+    BOOST_REQUIRE( sched.GetTaskToSend( workerJob, hostIP, spJob ) );
+    sched.OnTaskCompletion( 0, 1, WorkerTask( job->GetJobId(), 0 ), hostIP );
+
+    // job is removed from the scheduler, but its name is released by a deferred effect
+    BOOST_CHECK_EQUAL( sched.GetScheduledJobs().GetNumJobs(), 0 );
+    BOOST_CHECK_EQUAL( executor.effects_.size(), 2 );
+    BOOST_CHECK( !jobMgr.RegisterJobName( "named" ) );
+
+    executor.RunAll();
+    BOOST_CHECK( jobMgr.RegisterJobName( "named" ) );
+}
+
+BOOST_AUTO_TEST_CASE( completion_executor_order )
+{
+    boost::asio::io_service io_service;
+    CompletionExecutor executor( io_service );
+    executor.Start();
+
+    vector< int > order;
+    for( int i = 0; i < 100; ++i )
+    {
+        executor.Post( [&order, i]() { order.push_back( i ); } );
+    }
+    executor.Stop();
+    io_service.run();
+
+    BOOST_REQUIRE_EQUAL( order.size(), 100 );
+    for( int i = 0; i < 100; ++i )
+    {
+        BOOST_CHECK_EQUAL( order[i], i );
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -73,6 +73,37 @@ BOOST_AUTO_TEST_CASE( set_host_ip )
     BOOST_CHECK_EQUAL( (bool)w, false );
 }
 
+BOOST_AUTO_TEST_CASE( host_ids )
+{
+    AddWorkerHost( "grp", "host1" );
+    AddWorkerHost( "grp", "host2" );
+
+    vector< WorkerPtr > workers;
+    GetWorkers( workers );
+    BOOST_REQUIRE_EQUAL( workers.size(), 2 );
+    BOOST_CHECK( workers[0]->GetHostId() == HostIds::INVALID_ID );
+
+    SetWorkerIP( workers[0], "127.0.0.1" );
+    SetWorkerIP( workers[1], "127.0.0.2" );
+    BOOST_CHECK( workers[0]->GetHostId() != HostIds::INVALID_ID );
+    BOOST_CHECK( workers[0]->GetHostId() != workers[1]->GetHostId() );
+
+    // reappeared worker keeps its id
+    const uint32_t id = workers[0]->GetHostId();
+    DeleteWorkerHost( "host1" );
+    AddWorkerHost( "grp", "host1" );
+    workers.clear();
+    GetWorkers( workers );
+    for( auto &worker : workers )
+    {
+        if ( worker->GetHost() == "host1" )
+        {
+            SetWorkerIP( worker, "127.0.0.1" );
+            BOOST_CHECK_EQUAL( worker->GetHostId(), id );
+        }
+    }
+}
+
 BOOST_AUTO_TEST_CASE( check_command )
 {
     CommandPtr cmd;
@@ -66,7 +66,7 @@ typedef std::shared_ptr< Job > JobPtr;
 class JobExec : public Job
 {
 public:
-    typedef std::set<int> Tasks;
+    typedef common::IntervalSet Tasks;
 
 public:
     virtual std::string GetTaskType() const { return "exec"; }